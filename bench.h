@@ -0,0 +1,38 @@
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Searches a fixed set of positions to a fixed depth with a single thread, starting each one afresh,
+ * and adds up the nodes. Nothing about that depends on the clock, so the total comes out the same on every run:
+ * it is a signature of how the search behaves, which a change that is only meant to make it faster must not alter.
+ * The time taken gives the engine's speed on a realistic mix of positions.
+ *
+ * Runs with `./chess bench [depth?]` (or `make bench`), and from the shell with `bench [depth?]`.
+ */
+class Bench {
+public:
+    struct Result {
+        uint64_t nodes = 0;
+        long milliseconds = 0;
+
+        uint64_t getNodesPerSecond() const;
+    };
+    static const int DefaultDepth = 11;
+    static const int HashSizeMegabytes = 16;
+
+    /**
+     * Runs the benchmark, writing a line for each position as it goes and a summary at the end.
+     */
+    static Result run(int depth, std::ostream& out);
+private:
+    /**
+     * Openings, middlegames and endgames, quiet and tactical, with and without castling rights.
+     */
+    static const std::vector<std::string>& getFens();
+};
+
+#endif
@@ -88,6 +88,34 @@ bool Board::isNonSingular(Bitboard bb) {
     return bb & (bb - 1);
 }
 
+Bitboard Board::getFileFill(Bitboard bb) {
+    //smear everything up and down the board (a Kogge-Stone fill in each direction)
+    bb |= (bb << 8) | (bb >> 8);
+    bb |= (bb << 16) | (bb >> 16);
+    bb |= (bb << 32) | (bb >> 32);
+    return bb;
+}
+
+Bitboard Board::getAdjacentFiles(Bitboard files) {
+    //the masks stop things wrapping around from one edge of the board to the other
+    return ((files & ~FileH) << 1) | ((files & ~FileA) >> 1);
+}
+
+Bitboard Board::getFrontSpans(Color side, Bitboard bb) {
+    if(side == White) {
+        bb <<= 8;
+        bb |= bb << 8;
+        bb |= bb << 16;
+        bb |= bb << 32;
+    } else {
+        bb >>= 8;
+        bb |= bb >> 8;
+        bb |= bb >> 16;
+        bb |= bb >> 32;
+    }
+    return bb;
+}
+
 void Board::setBit(Bitboard& bb, Square bit) {
     assert(!testBit(bb, bit));
     bb ^= 1ull << bit;
@@ -125,21 +153,73 @@ bool Board::isFiftyMoveRuleDraw() const {
     return plies > 99; 
 }
 
+bool Board::isDrawn(int searchPly) const {
+    return isFiftyMoveRuleDraw() || isRepetition(searchPly) || isInsufficientMaterialDraw();
+}
+
 bool Board::isThreefoldDraw() const {
     int repetitions = 0;
-    //Look through all the moves played thus far
-    for(int i = fullmoves - 2; i >= 0; i -= 2) {
-        //we can no longer repeat if a fifty-move-rule resetting move was made
-        if(i < fullmoves - plies) {
-            break;
+    int size = keyHistory.size();
+    //we can no longer repeat anything from before a fifty-move-rule resetting move
+    int end = std::min(plies, size);
+    for(int distance = 4; distance <= end; distance += 2) {
+        if(keyHistory[size - distance] == positionHash && ++repetitions == 2) {
+            return true;
         }
-        if(undoStack[i].positionHash == positionHash) {
-            if(++repetitions == 3) {
+    }
+    return false;
+}
+
+bool Board::isRepetition(int searchPly) const {
+    int size = keyHistory.size();
+    int end = std::min(plies, size);
+    bool repeatedBeforeRoot = false;
+    //the position 2 moves ago can't be the same, since both sides have moved a piece once
+    for(int distance = 4; distance <= end; distance += 2) {
+        if(keyHistory[size - distance] == positionHash) {
+            if(distance < searchPly || repeatedBeforeRoot) {
                 return true;
             }
-        }    
+            repeatedBeforeRoot = true;
+        }
     }
+    return false;
+}
 
+bool Board::hasUpcomingRepetition(int searchPly) const {
+    int size = keyHistory.size();
+    int end = std::min(plies, size);
+    Bitboard occupiedBoard = sides[White] | sides[Black];
+    //an odd number of moves back, so it was the other side to move there and one move of ours can get back to it
+    for(int distance = 3; distance <= end; distance += 2) {
+        Square square1;
+        Square square2;
+        if(!ZobristNums::findCuckooMove(positionHash ^ keyHistory[size - distance], square1, square2)) {
+            continue;
+        }
+        //the piece can only get there if nothing is in its way
+        if((PrecomputedBinary::getBinary().getBetweenSquaresMask(square1, square2) & occupiedBoard) != 0) {
+            continue;
+        }
+        if(distance < searchPly) {
+            return true;
+        }
+        //from before the root, it has to be our piece going back (not theirs having just come),
+        //and that position has to have come up twice already
+        Square pieceSquare = squares[square1] == Empty ? square2 : square1;
+        if(getColorOfPiece(squares[pieceSquare]) == turn && wasRepeatedAt(size - distance, plies - distance)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Board::wasRepeatedAt(int index, int reversible) const {
+    for(int i = index - 4; i >= std::max(0, index - reversible); i -= 2) {
+        if(keyHistory[i] == keyHistory[index]) {
+            return true;
+        }
+    }
     return false;
 }
 
@@ -167,17 +247,10 @@ Square Board::squareFromString(const std::string& string) {
     return getSquare(string[1] - '1', string[0] - 'a');
 }
 
-Board::Board() : positionHash{0}, kingAttackers{0}, castlingRooks{0}, turn{White}, plies{0}, fullmoves{0}, enpassantSquare{None} {
-    for(int i = 0; i < 6; i++) {
-        pieces[i] = 0;
-    }
-    for(int i = 0; i < 2; i++) {
-        sides[i] = 0;
-    }
-    for(int i = 0; i < 64; i++) {
-        squares[i] = Empty;
-	    castleMasks[i] = 0;
-    }
+Board::Board() : Position{} {
+    squares.fill(Empty);
+    turn = White;
+    enpassantSquare = None;
     //shorter thing to type, who said programmers weren't lazy
     PrecomputedBinary::getBinary().init();
 }
@@ -226,16 +299,29 @@ void Board::PrecomputedBinary::init() {
         populateHashTable(BishopTable, sq, BishopHashes[sq], bishopMovementDelta);
 	    populateHashTable(RookTable, sq, RookHashes[sq], rookMovementDelta);
     }
+#if defined(__x86_64__)
+    pextAvailable = __builtin_cpu_supports("bmi2");
+    usePext = pextAvailable && !__builtin_cpu_is("znver1") && !__builtin_cpu_is("znver2");
+#endif
+    if(pextAvailable) {
+        //PEXT indices go up to the same 2^(mask bits) as the magic ones, so the tables are laid out the same way
+        for(int square = a1; square <= h8; square++) {
+            populatePextTable(BishopTable, getSquare(square), BishopPextAttack + (BishopTable[square].offset - BishopAttack), bishopMovementDelta);
+            populatePextTable(RookTable, getSquare(square), RookPextAttack + (RookTable[square].offset - RookAttack), rookMovementDelta);
+        }
+    }
     //Initialize masks (depend on attacks being done)
     for(int square1 = a1; square1 <= h8; square1++) {
         for(int square2 = a1; square2 <= h8; square2++) {
             //Align this on rank/file if the squares are straight away
             if(testBit(getRookAttacksFromSquare(getSquare(square1), 0), getSquare(square2))) {
                 BetweenSquaresMasks[square1][square2] = getRookAttacksFromSquare(getSquare(square1), 1ull << square2) & getRookAttacksFromSquare(getSquare(square2), 1ull << square1);
+                LineMasks[square1][square2] = (getRookAttacksFromSquare(getSquare(square1), 0) & getRookAttacksFromSquare(getSquare(square2), 0)) | (1ull << square1) | (1ull << square2);
             }
             //Align this on diagonal if the squares are diagonally away
             if(testBit(getBishopAttacksFromSquare(getSquare(square1), 0), getSquare(square2))) {
                 BetweenSquaresMasks[square1][square2] = getBishopAttacksFromSquare(getSquare(square1), 1ull << square2) & getBishopAttacksFromSquare(getSquare(square2), 1ull << square1);
+                LineMasks[square1][square2] = (getBishopAttacksFromSquare(getSquare(square1), 0) & getBishopAttacksFromSquare(getSquare(square2), 0)) | (1ull << square1) | (1ull << square2);
             }
         }
     }
@@ -273,6 +359,11 @@ Bitboard Board::PrecomputedBinary::getBetweenSquaresMask(Square square1, Square
     return BetweenSquaresMasks[square1][square2];
 }
 
+Bitboard Board::PrecomputedBinary::getLineMask(Square square1, Square square2) {
+    assert(square1 != None && square2 != None);
+    return LineMasks[square1][square2];
+}
+
 Bitboard Board::PrecomputedBinary::getAdjacentFilesMask(Index fileIndex) {
     return AdjacentFilesMasks[fileIndex];
 }
@@ -289,11 +380,36 @@ Bitboard Board::PrecomputedBinary::getPawnAttacksFromSquare(Square square, Color
     return PawnAttack[side][square];
 }
 
+void Board::PrecomputedBinary::populatePextTable(HashEntry* table, Square square, Bitboard* attacks, const MultiArray<int, 4, 2>& movementDelta) {
+    table[square].pextOffset = attacks;
+    //go through every subset of the mask (the same trick as populateHashTable)
+    Bitboard occupiedBoard = 0;
+    do {
+        attacks[parallelBitsExtract(occupiedBoard, table[square].mask)] = calculateRookBishopAttacks(square, occupiedBoard, movementDelta);
+        occupiedBoard = (occupiedBoard - table[square].mask) & table[square].mask;
+    } while(occupiedBoard != 0);
+}
+
+bool Board::PrecomputedBinary::setPextEnabled(bool enabled) {
+    usePext = enabled && pextAvailable;
+    return usePext == enabled;
+}
+
+bool Board::PrecomputedBinary::isPextEnabled() const {
+    return usePext;
+}
+
 Bitboard Board::PrecomputedBinary::getBishopAttacksFromSquare(Square square, Bitboard occupiedBoard) {
+    if(usePext) {
+        return BishopTable[square].pextOffset[parallelBitsExtract(occupiedBoard, BishopTable[square].mask)];
+    }
     return BishopTable[square].offset[computeHashTableIndex(occupiedBoard, BishopTable[square])];
 }
 
 Bitboard Board::PrecomputedBinary::getRookAttacksFromSquare(Square square, Bitboard occupiedBoard) {
+    if(usePext) {
+        return RookTable[square].pextOffset[parallelBitsExtract(occupiedBoard, RookTable[square].mask)];
+    }
     return RookTable[square].offset[computeHashTableIndex(occupiedBoard, RookTable[square])];
 }
 
@@ -332,6 +448,48 @@ Bitboard Board::getAllKingAttackers() {
     return getAllSquareAttackers(occupiedBoard, square) & sides[flipColor(turn)];
 }
 
+Bitboard Board::getKingAttackersAfterMove(const Move& move) const {
+    assert(move.getMoveType() == Move::Normal || move.getMoveType() == Move::Promotion);
+    Square kingSquare = getSquare(getLsb(sides[turn] & pieces[King]));
+    Bitboard occupiedBoard = sides[White] | sides[Black];
+    Color mover = flipColor(turn);
+    //their king wasn't in check before (or it would have been their move), so if it is now, we did it
+    Bitboard attackers = getSliderAttackersThrough(move.getFrom(), kingSquare, occupiedBoard, mover);
+    if(testBit(getPieceAttacksFromSquare(getPieceType(squares[move.getTo()]), move.getTo(), occupiedBoard, mover), kingSquare)) {
+        attackers |= 1ull << move.getTo();
+    }
+    return attackers;
+}
+
+Bitboard Board::getPieceAttacksFromSquare(Piece piece, Square square, Bitboard occupiedBoard, Color side) {
+    switch(piece) {
+        case Pawn:
+            return PrecomputedBinary::getBinary().getPawnAttacksFromSquare(square, side);
+        case Knight:
+            return PrecomputedBinary::getBinary().getKnightAttacksFromSquare(square);
+        case Bishop:
+            return PrecomputedBinary::getBinary().getBishopAttacksFromSquare(square, occupiedBoard);
+        case Rook:
+            return PrecomputedBinary::getBinary().getRookAttacksFromSquare(square, occupiedBoard);
+        case Queen:
+            return PrecomputedBinary::getBinary().getQueenAttacksFromSquare(square, occupiedBoard);
+        default:
+            return PrecomputedBinary::getBinary().getKingAttacksFromSquare(square);
+    }
+}
+
+Bitboard Board::getSliderAttackersThrough(Square from, Square target, Bitboard occupiedBoard, Color side) const {
+    Bitboard line = PrecomputedBinary::getBinary().getLineMask(from, target);
+    //not lined up with the target, so nothing can be coming through
+    if(line == 0) {
+        return 0;
+    }
+    if(getRankIndexOfSquare(from) == getRankIndexOfSquare(target) || getFileIndexOfSquare(from) == getFileIndexOfSquare(target)) {
+        return PrecomputedBinary::getBinary().getRookAttacksFromSquare(target, occupiedBoard) & line & sides[side] & (pieces[Rook] | pieces[Queen]);
+    }
+    return PrecomputedBinary::getBinary().getBishopAttacksFromSquare(target, occupiedBoard) & line & sides[side] & (pieces[Bishop] | pieces[Queen]);
+}
+
 bool Board::isSquareAttacked(Square square, Color side) {
     Bitboard enemyPieces = sides[flipColor(side)];
     Bitboard occupiedBoard = sides[White] | sides[Black];
@@ -520,6 +678,8 @@ Board::BoardLegality Board::getBoardLegalityState() const {
 
 Board Board::createBoardFromFEN(std::string fen) {
     Board board;
+    board.searchStack = std::make_unique<SearchStack>();
+    board.keyHistory.reserve(MaxDepth);
     int square = a8;
     
     std::string token = fen.substr(0, fen.find(" "));
@@ -598,20 +758,56 @@ Board Board::createBoardFromFEN(std::string fen) {
 
 void Board::validateLegality() {
     assert(getBoardLegalityState() == Legal);
-    //Create a bit mask of where the kings and rooks are
-    for(int sq = 0; sq < NumSquares; sq++) {
-	    Square s = getSquare(sq);
-        castleMasks[s] = ~0ull;
-	    if(testBit(castlingRooks, s)) {
-	        clearBit(castleMasks[sq], s);
-	    } else if(testBit(sides[White] & pieces[King], s)) {
-	        castleMasks[sq] &= ~sides[White];
-	    } else if(testBit(sides[Black] & pieces[King], s)) {
-	        castleMasks[sq] &= ~sides[Black];
-	    }
-    }
     kingAttackers = getAllKingAttackers();
+    positionHash = ZobristNums::hashPosition(*this);
     initMaterialEval();
+    initPawnHash();
+}
+
+Board Board::clonePosition() const {
+    Board board;
+    static_cast<Position&>(board) = *this;
+    return board;
+}
+
+Board Board::cloneForSearch() const {
+    assert(undoCount == 0);
+    Board board = clonePosition();
+    board.accumulator = accumulator;
+    board.searchStack = std::make_unique<SearchStack>();
+    //nothing from before the last capture or pawn move can come up again
+    board.keyHistory.reserve(plies + MaxDepth);
+    board.keyHistory.assign(keyHistory.end() - std::min(plies, (int)keyHistory.size()), keyHistory.end());
+    if(!gameHistory.empty()) {
+        board.gameHistory.push_back(gameHistory.back());
+    }
+    return board;
+}
+
+Board::Board(const Board& board) : Position(board), accumulator(board.accumulator), gameHistory(board.gameHistory), keyHistory(board.keyHistory) {
+    assert(board.undoCount == 0);
+}
+
+Board& Board::operator=(const Board& board) {
+    assert(undoCount == 0 && board.undoCount == 0);
+    static_cast<Position&>(*this) = board;
+    accumulator = board.accumulator;
+    gameHistory = board.gameHistory;
+    keyHistory = board.keyHistory;
+    if(searchStack != nullptr) {
+        keyHistory.reserve(keyHistory.size() + MaxDepth);
+    }
+    return *this;
+}
+
+void Board::initPawnHash() {
+    pawnHash = 0;
+    for(Color side : {White, Black}) {
+        Bitboard pawns = pieces[Pawn] & sides[side];
+        while(pawns != 0) {
+            ZobristNums::changePiece(pawnHash, side, Pawn, getSquare(popLsb(pawns)));
+        }
+    }
 }
 
 std::string Board::getFEN() const {
@@ -637,64 +833,6 @@ void Board::setTurn(Color turn) {
     this->turn = turn;
 }
 
-void Board::perftTest(int depth) {
-    perftRootDepth = depth;
-    std::map<std::string, int> divideTree;
-    int promotions = 0;
-    int castles = 0;
-    int enpassant = 0;
-
-    auto start = std::chrono::system_clock::now();
-    unsigned long long nodes = perft(divideTree, depth, enpassant, promotions, castles);
-    auto end = std::chrono::system_clock::now();
-
-    std::cout << " ◌ Perft test generated " << nodes << " in "  << std::chrono::duration_cast<std::chrono::milliseconds>((end - start)).count() << " milliseconds." << std::endl;
-    std::cout << " ◌ Promotion moves in leaf nodes: " << promotions << std::endl;
-    std::cout << " ◌ Castling moves in leaf nodes: " << castles << std::endl;
-    std::cout << " ◌ Enpassant moves in leaf nodes: " << enpassant << std::endl;
-    std::cout << " ◌ Divide tree:" << std::endl;
-    for(auto const& x : divideTree) {
-        std::cout << " ◌ " << x.first << ":" << x.second << std::endl;
-    }
- }
-
-unsigned long long Board::perft(std::map<std::string, int>& divideTree, int depth, int& enpassant, int& promotions, int& castles) {
-    if(depth == 0) {
-        return 1;
-    }
-    unsigned long long numMoves = 0;
-    
-    undoStack.emplace_back();
-    std::vector<Move> moveList;
-    moveList.reserve(MaxNumMoves);
-
-    generateAllNoisyMoves(moveList);
-    generateAllQuietMoves(moveList);
-
-    for(Move& move : moveList) {
-        applyMoveWithUndo(move, undoStack.back());
-        if(!didLastMoveLeaveInCheck()) {
-            if(depth == 1) {
-                if(move.getMoveType() == Move::MoveType::Enpassant) {
-                    enpassant++;
-                } else if(move.getMoveType() == Move::MoveType::Promotion) {
-                    promotions++;
-                } else if(move.getMoveType() == Move::MoveType::Castle) {
-                    castles++;
-                }
-            }
-            int subNodes = perft(divideTree, depth - 1, enpassant, promotions, castles);
-            if(depth == perftRootDepth) {
-                divideTree[move.toString()] += subNodes;
-            }
-            numMoves += subNodes;
-        }
-        revertMove(undoStack.back());
-    }
-    undoStack.pop_back();
-    return numMoves;
-}
-
 Bitboard Board::PrecomputedBinary::calculateRookBishopAttacks(Square square, Bitboard occupiedBoard, const MultiArray<int, 4, 2>& movementDelta) {
     Bitboard result = 0;
     for(int i = 0; i < 4; i++) {
@@ -735,15 +873,73 @@ void Board::PrecomputedBinary::populateHashTable(HashEntry* table, Square square
 }
 
 void Board::evalAddPiece(ColorPiece piece, Square location) {
-    currentEval += psqt.at(piece)[location];
+    currentEval += psqt[piece][location];
+    gamePhase += ColorPiecePhases[piece];
+    if(piece != Empty && (accumulator.upToDate[White] || accumulator.upToDate[Black])) {
+        updateAccumulator(piece, location, true);
+    }
 }
 
 void Board::evalRemovePiece(ColorPiece piece, Square location) {
-    currentEval -= psqt.at(piece)[location];
+    currentEval -= psqt[piece][location];
+    gamePhase -= ColorPiecePhases[piece];
+    if(piece != Empty && (accumulator.upToDate[White] || accumulator.upToDate[Black])) {
+        updateAccumulator(piece, location, false);
+    }
+}
+
+void Board::updateAccumulator(ColorPiece piece, Square location, bool add) {
+    const Network& network = Network::getNetwork();
+    for(Color perspective : {White, Black}) {
+        if(!accumulator.upToDate[perspective]) {
+            continue;
+        }
+        //every feature depends on where our king is, so moving it means starting over (lazily, in getAccumulator)
+        if(piece == makePiece(King, perspective)) {
+            accumulator.upToDate[perspective] = false;
+            continue;
+        }
+        int feature = Network::getFeatureIndex(perspective, accumulator.kings[perspective], piece, location);
+        if(add) {
+            network.addFeature(accumulator.values[perspective].data(), feature);
+        } else {
+            network.removeFeature(accumulator.values[perspective].data(), feature);
+        }
+    }
+}
+
+void Board::refreshAccumulator(Color perspective) const {
+    const Network& network = Network::getNetwork();
+    Square king = getSquare(getLsb(pieces[King] & sides[perspective]));
+    network.resetToBias(accumulator.values[perspective].data());
+    Bitboard occupied = sides[White] | sides[Black];
+    while(occupied != 0) {
+        Square square = getSquare(popLsb(occupied));
+        network.addFeature(accumulator.values[perspective].data(), Network::getFeatureIndex(perspective, king, squares[square], square));
+    }
+    accumulator.kings[perspective] = king;
+    accumulator.upToDate[perspective] = true;
+}
+
+const Network::Accumulator& Board::getAccumulator() const {
+    assert(Network::getNetwork().isLoaded());
+    //a newly loaded network makes everything computed with the old one meaningless
+    if(accumulator.generation != Network::getNetwork().getGeneration()) {
+        accumulator.upToDate = {false, false};
+        accumulator.generation = Network::getNetwork().getGeneration();
+    }
+    for(Color perspective : {White, Black}) {
+        if(!accumulator.upToDate[perspective]) {
+            refreshAccumulator(perspective);
+        }
+    }
+    return accumulator;
 }
 
 void Board::initMaterialEval() {
     currentEval = 0;
+    gamePhase = 0;
+    accumulator.upToDate = {false, false};
     for (int i = 0; i < NumSquares; ++i) {
         evalAddPiece(squares[getSquare(i)], getSquare(i));
     }
@@ -754,16 +950,54 @@ bool Board::applyMove(Move& move) {
     if(move.isMoveNone()) {
         return false;
     }
-    undoStack.emplace_back();
-    applyMoveWithUndo(move, undoStack.back());
+    applyMoveWithUndo(move, pushUndo());
     if(didLastMoveLeaveInCheck()) {
-        revertMove(undoStack.back());
-        undoStack.pop_back();
+        revertMostRecent();
         return false;
     }
     return true;
 }
 
+bool Board::playMove(Move& move) {
+    assert(undoCount == 0);
+    if(!applyMove(move)) {
+        return false;
+    }
+    //it's part of the game now, so it moves off the search stack
+    UndoData& undo = searchStack->undo[--undoCount];
+    undo.accumulatorSaved = false;
+    gameHistory.push_back(undo);
+    if(keyHistory.capacity() < keyHistory.size() + MaxDepth) {
+        keyHistory.reserve(2 * keyHistory.size() + MaxDepth);
+    }
+    return true;
+}
+
+Board::UndoData& Board::pushUndo() {
+    assert(undoCount < MaxDepth);
+    //copies don't get a search stack until they need one
+    if(searchStack == nullptr) {
+        searchStack = std::make_unique<SearchStack>();
+        keyHistory.reserve(keyHistory.size() + MaxDepth);
+    }
+    keyHistory.push_back(positionHash);
+    UndoData& undo = searchStack->undo[undoCount];
+    //the accumulator is only worth keeping (and updating) if something is using it
+    undo.accumulatorSaved = accumulator.upToDate[White] || accumulator.upToDate[Black];
+    if(undo.accumulatorSaved) {
+        searchStack->accumulators[undoCount] = accumulator;
+    }
+    undoCount++;
+    return undo;
+}
+
+const Board::UndoData* Board::getLastUndo() const {
+    if(undoCount > 0) {
+        return &searchStack->undo[undoCount - 1];
+    }
+    return gameHistory.empty() ? nullptr : &gameHistory.back();
+}
+
 bool Board::didLastMoveLeaveInCheck() {
     Square kingSquare = getSquare(getLsb(sides[flipColor(turn)] & pieces[King]));
     return isSquareAttacked(kingSquare, flipColor(turn));
@@ -774,22 +1008,22 @@ bool Board::isSideInCheck(Color side) {
 }
 
 void Board::applyLegalMove(Move& move) {
-    undoStack.emplace_back();
-    applyMoveWithUndo(move, undoStack.back());
+    applyMoveWithUndo(move, pushUndo());
     assert(!didLastMoveLeaveInCheck());
 }
 
 void Board::applyMoveWithUndo(Move& move, UndoData& undo) {
-    undo.positionHash = positionHash;
-    undo.kingAttackers = kingAttackers;
-    undo.castlingRooks = castlingRooks;
-    undo.enpassantSquare = enpassantSquare;
-    undo.plies = plies;
+    undo.position = *this;
     undo.move = move;
-    undo.currentEval = currentEval;
 
     fullmoves++;
 
+    //enpassant only lasts a move (a 2 pawn forward move sets it again below)
+    if(enpassantSquare != None) {
+        ZobristNums::changeEnPassant(positionHash, getFileIndexOfSquare(enpassantSquare));
+        enpassantSquare = None;
+    }
+
     switch(move.getMoveType()) {
 	    case Move::MoveType::Normal:
 	        applyNormalMoveWithUndo(move, undo);
@@ -805,34 +1039,23 @@ void Board::applyMoveWithUndo(Move& move, UndoData& undo) {
             break;  
     }
 
-    //if the enpassant square was not updated (i.e. no 2 pawn forward move was played),
-    //then enpassant expires and we must remove it
-    if(enpassantSquare == undo.enpassantSquare) {
-        if (enpassantSquare != None) {
-            ZobristNums::changeEnPassant(positionHash, getFileIndexOfSquare(enpassantSquare));
-        } 
-        enpassantSquare = None;
-    }
-
     // if castling permissions are different, reflect this in zobrist
-    Bitboard rookChanges = castlingRooks & (~undo.castlingRooks);
-    if ((rookChanges & sides[White] & FileA) != 0) {
-        ZobristNums::changeCastleRights(positionHash, White, true);
-    }
-    if ((rookChanges & sides[Black] & FileA) != 0) {
-        ZobristNums::changeCastleRights(positionHash, White, false);
-    }
-    if ((rookChanges & sides[White] & FileH) != 0) {
-        ZobristNums::changeCastleRights(positionHash, Black, true);
-    }
-    if ((rookChanges & sides[Black] & FileH) != 0) {
-        ZobristNums::changeCastleRights(positionHash, Black, false);
+    if(castlingRooks != undo.position.castlingRooks) {
+        ZobristNums::changeCastleRights(positionHash, undo.position.castlingRooks);
+        ZobristNums::changeCastleRights(positionHash, castlingRooks);
     }
 
     //flip whose turn it is
     turn = flipColor(turn);
     ZobristNums::flipColor(positionHash);
-    kingAttackers = getAllKingAttackers();
+    //castling and en passant move two things at once, so just look at everything for those
+    if(move.getMoveType() == Move::Normal || move.getMoveType() == Move::Promotion) {
+        kingAttackers = getKingAttackersAfterMove(move);
+    } else {
+        kingAttackers = getAllKingAttackers();
+    }
+    assert(kingAttackers == getAllKingAttackers());
+    assert(positionHash == ZobristNums::hashPosition(*this));
 }
 
 void Board::applyNormalMoveWithUndo(Move& move, UndoData& undo) {
@@ -851,6 +1074,10 @@ void Board::applyNormalMoveWithUndo(Move& move, UndoData& undo) {
     //zobrist hash update
     ZobristNums::changePiece(positionHash, getColorOfPiece(from), getPieceType(from), move.getFrom());
     ZobristNums::changePiece(positionHash, getColorOfPiece(from), getPieceType(from), move.getTo());
+    if(getPieceType(from) == Pawn) {
+        ZobristNums::changePiece(pawnHash, getColorOfPiece(from), Pawn, move.getFrom());
+        ZobristNums::changePiece(pawnHash, getColorOfPiece(from), Pawn, move.getTo());
+    }
 
     // material eval update
     evalAddPiece(from, move.getTo());
@@ -861,14 +1088,20 @@ void Board::applyNormalMoveWithUndo(Move& move, UndoData& undo) {
         pieces[getPieceType(to)] ^= (1ull << move.getTo());
         sides[flipColor(turn)] ^= (1ull << move.getTo());
         ZobristNums::changePiece(positionHash, getColorOfPiece(to), getPieceType(to), move.getTo());
+        if(getPieceType(to) == Pawn) {
+            ZobristNums::changePiece(pawnHash, getColorOfPiece(to), Pawn, move.getTo());
+        }
         evalRemovePiece(to, move.getTo());
     }
 
     squares[move.getFrom()] = Empty;
     squares[move.getTo()] = from;
 
-    castlingRooks &= castleMasks[move.getFrom()];
-    castlingRooks &= castleMasks[move.getTo()];
+    //a rook that moves or is captured can't castle any more, and neither rook can once the king has moved
+    castlingRooks &= ~((1ull << move.getFrom()) | (1ull << move.getTo()));
+    if(getPieceType(from) == King) {
+        castlingRooks &= ~getBackRank(turn);
+    }
     undo.pieceCaptured = to;
 
     //if we move 2 forward, set enpassant data
@@ -919,7 +1152,7 @@ void Board::applyCastlingMoveWithUndo(Move& move, Board::UndoData& undo) {
     squares[kingTo] = makePiece(King, turn);
     squares[rookTo] = makePiece(Rook, turn);
     
-    castlingRooks &= castleMasks[kingFrom]; 
+    castlingRooks &= ~getBackRank(turn);
 
     undo.pieceCaptured = Empty;
 
@@ -933,6 +1166,9 @@ void Board::applyEnpassantMoveWithUndo(Move& move, Board::UndoData& undo) {
     ZobristNums::changePiece(positionHash, getColorOfPiece(squares[move.getFrom()]), Pawn, move.getTo());
     ZobristNums::changePiece(positionHash, getColorOfPiece(squares[move.getFrom()]), Pawn, move.getFrom());
     ZobristNums::changePiece(positionHash, flipColor(getColorOfPiece(squares[move.getFrom()])), Pawn, capturedSquare);
+    ZobristNums::changePiece(pawnHash, getColorOfPiece(squares[move.getFrom()]), Pawn, move.getTo());
+    ZobristNums::changePiece(pawnHash, getColorOfPiece(squares[move.getFrom()]), Pawn, move.getFrom());
+    ZobristNums::changePiece(pawnHash, flipColor(getColorOfPiece(squares[move.getFrom()])), Pawn, capturedSquare);
 
     //materialEval update
     evalAddPiece(squares[move.getFrom()], move.getTo());
@@ -960,6 +1196,7 @@ void Board::applyPromotionMoveWithUndo(Move& move, Board::UndoData& undo) {
     //zobrist hash update
     ZobristNums::changePiece(positionHash, getColorOfPiece(promotedPiece), Pawn, move.getFrom());
     ZobristNums::changePiece(positionHash, getColorOfPiece(promotedPiece), move.getPromoType(), move.getTo());
+    ZobristNums::changePiece(pawnHash, getColorOfPiece(promotedPiece), Pawn, move.getFrom());
 
     //material eval
     evalAddPiece(promotedPiece, move.getTo());
@@ -982,98 +1219,33 @@ void Board::applyPromotionMoveWithUndo(Move& move, Board::UndoData& undo) {
     squares[move.getTo()] = promotedPiece;
     undo.pieceCaptured = capturedPiece;
 
-    castlingRooks &= castleMasks[move.getTo()];
+    castlingRooks &= ~(1ull << move.getTo());
 }
 
 int Board::countLegalMoves() {
-    std::vector<Move> moveList;
-    moveList.reserve(MaxNumMoves);
+    MoveList moveList;
     return generateAllLegalMoves(moveList);
 }
 
 void Board::revertMostRecent() {
-    revertMove(undoStack.back());
-    undoStack.pop_back();
+    UndoData& undo = searchStack->undo[--undoCount];
+    keyHistory.pop_back();
+    revertMove(undo);
+    if(undo.accumulatorSaved) {
+        accumulator = searchStack->accumulators[undoCount];
+    }
 }
 
-void Board::revertMove(UndoData& undo) {
-    positionHash = undo.positionHash;
-    kingAttackers = undo.kingAttackers;
-    enpassantSquare = undo.enpassantSquare;
-    plies = undo.plies;
-    castlingRooks = undo.castlingRooks;
-    Move& move = undo.move;
-    currentEval = undo.currentEval;
-
-    turn = flipColor(turn);
-    fullmoves--;
-
-    switch(move.getMoveType()) {
-        case Move::MoveType::Normal: {
-            Piece fromType = getPieceType(squares[move.getTo()]);
-
-            pieces[fromType] ^= (1ull << move.getFrom()) ^ (1ull << move.getTo());
-            sides[turn] ^= (1ull << move.getFrom()) ^ (1ull << move.getTo());
-
-            if(undo.pieceCaptured != Empty) {
-                pieces[getPieceType(undo.pieceCaptured)] ^= (1ull << move.getTo());
-                sides[getColorOfPiece(undo.pieceCaptured)] ^= (1ull << move.getTo());
-            }
-
-            squares[move.getFrom()] = squares[move.getTo()];
-            squares[move.getTo()] = undo.pieceCaptured;
-            break;
-        }
-        case Move::MoveType::Castle: {
-            Square rookFrom = move.getTo();
-            Square rookTo = getRookCastlingSquare(move.getFrom(), rookFrom);
-            Square kingTo = getKingCastlingSquare(move.getFrom(), rookFrom);
-
-            pieces[King] ^= (1ull << move.getFrom()) ^ (1ull << kingTo);
-            sides[turn] ^= (1ull << move.getFrom()) ^ (1ull << kingTo);
-
-            pieces[Rook] ^= (1ull << rookFrom) ^ (1ull << rookTo);
-            sides[turn] ^= (1ull << rookFrom) ^ (1ull << rookTo);
-
-            squares[kingTo] = Empty;
-            squares[rookTo] = Empty;
-
-            squares[move.getFrom()] = makePiece(King, turn);
-            squares[rookFrom] = makePiece(Rook, turn);
-            break;
-        }
-        case Move::MoveType::Promotion: {
-            pieces[Pawn] ^= (1ull << move.getFrom());
-            pieces[move.getPromoType()] ^= (1ull << move.getTo());
-            sides[turn] ^= (1ull << move.getFrom()) ^ (1ull << move.getTo());
-
-            if(undo.pieceCaptured != Empty) {
-                pieces[getPieceType(undo.pieceCaptured)] ^= (1ull << move.getTo());
-                sides[getColorOfPiece(undo.pieceCaptured)] ^= (1ull << move.getTo());
-            }
-
-            squares[move.getFrom()] = makePiece(Pawn, turn);
-            squares[move.getTo()] = undo.pieceCaptured;
-            break;
-        }
-        case Move::MoveType::Enpassant: {
-            int turnBit = turn == White ? 0 : 1;
-            Square enpassantCaptureSquare = getSquare(move.getTo() - 8 + (turnBit << 4));
-
-            pieces[Pawn] ^= (1ull << move.getFrom()) ^ (1ull << move.getTo());
-            sides[turn] ^= (1ull << move.getFrom()) ^ (1ull << move.getTo());
-
-            pieces[Pawn] ^= (1ull << enpassantCaptureSquare);
-            sides[flipColor(turn)] ^= (1ull << enpassantCaptureSquare);
+void Board::revertPlayedMove() {
+    assert(undoCount == 0 && !gameHistory.empty());
+    keyHistory.pop_back();
+    revertMove(gameHistory.back());
+    gameHistory.pop_back();
+}
 
-            squares[move.getFrom()] = squares[move.getTo()];
-            squares[move.getTo()] = Empty;
-            squares[enpassantCaptureSquare] = undo.pieceCaptured;
-            break;
-        }
-        default:
-            std::cerr << "AHHHHHHH" << std::endl;    
-    }
+void Board::revertMove(UndoData& undo) {
+    static_cast<Position&>(*this) = undo.position;
+    accumulator.upToDate = {false, false};
 }
 
 bool Board::isMovePseudoLegal(Move& move) {
@@ -1165,20 +1337,20 @@ bool Board::isMoveLegal(Move& move) {
     Square kingSquare = getSquare(getLsb(pieces[King] & sides[flipColor(turn)]));
     return isMovePseudoLegal(move) && !isSquareAttacked(kingSquare, flipColor(turn));
 }
-void Board::addEnpassantMoves(std::vector<Move>& moveList, Bitboard sources, Square enpassantSquare) {
+void Board::addEnpassantMoves(MoveList& moveList, Bitboard sources, Square enpassantSquare) {
     while(sources != 0) {
         moveList.emplace_back(getSquare(popLsb(sources)), enpassantSquare, Move::MoveType::Enpassant);
     }
 }
 
-void Board::addPawnMoves(std::vector<Move>& moveList, Bitboard targets, int directionPawnIsIn) {
+void Board::addPawnMoves(MoveList& moveList, Bitboard targets, int directionPawnIsIn) {
     while(targets != 0) {
         Square square = getSquare(popLsb(targets));
         moveList.emplace_back(getSquare(square + directionPawnIsIn), square, Move::MoveType::Normal);
     }
 }
 
-void Board::addPawnPromotions(std::vector<Move>& moveList, Bitboard targets, int directionPawnIsIn) {
+void Board::addPawnPromotions(MoveList& moveList, Bitboard targets, int directionPawnIsIn) {
     while(targets != 0) {
         Square square = getSquare(popLsb(targets));
         //bias our move ordering QNRB since that's the most likely order of promotions (a moral victory, there is a 0% chance this has impact on playing strength)
@@ -1189,13 +1361,13 @@ void Board::addPawnPromotions(std::vector<Move>& moveList, Bitboard targets, int
     }
 }
 
-void Board::addNormalMoves(std::vector<Move>& moveList, Bitboard targets, Square from) {
+void Board::addNormalMoves(MoveList& moveList, Bitboard targets, Square from) {
     while(targets != 0) {
         moveList.emplace_back(from, getSquare(popLsb(targets)), Move::MoveType::Normal);
     }
 }
 
-void Board::addNonPawnNormalMoves(std::vector<Move>& moveList, Piece type, Bitboard targets, Bitboard sources, Bitboard occupiedBoard) {
+void Board::addNonPawnNormalMoves(MoveList& moveList, Piece type, Bitboard targets, Bitboard sources, Bitboard occupiedBoard) {
     assert(type != Pawn && type != Queen); //queen should be given separately as rook and bishop
     //Have the switch on the outside of the loops so we don't have to rely on branch prediction not being dumb
     switch(type) {
@@ -1241,7 +1413,7 @@ bool Board::isSquareInBoardAttacked(Bitboard board, Color turn) {
     return false;
 }
 
-int Board::generateAllNoisyMoves(std::vector<Move>& moveList) {
+int Board::generateAllNoisyMoves(MoveList& moveList) {
     const int startSize = moveList.size();
     Bitboard occupiedBoard = sides[White] | sides[Black];
 
@@ -1253,8 +1425,9 @@ int Board::generateAllNoisyMoves(std::vector<Move>& moveList) {
     }
 
     //If we are in check by >1 piece, the only legal way to get out of it is to move the king
+    //(and it can capture any piece, not just a checker)
     if(isNonSingular(kingAttackers)) {
-        addNonPawnNormalMoves(moveList, King, opponents, sides[turn] & pieces[King], occupiedBoard);
+        addNonPawnNormalMoves(moveList, King, sides[flipColor(turn)], sides[turn] & pieces[King], occupiedBoard);
         return moveList.size() - startSize;
     }
 
@@ -1291,24 +1464,98 @@ int Board::generateAllNoisyMoves(std::vector<Move>& moveList) {
     return moveList.size() - startSize;
 }
 
-int Board::generateAllNoisyMovesAndChecks(std::vector<Move>& moveList) {
+int Board::generateAllNoisyMovesAndChecks(MoveList& moveList) {
     const int startSize = moveList.size();
-    std::vector<Move> checks;
     generateAllNoisyMoves(moveList);
-    generateAllQuietMoves(checks);
-    undoStack.emplace_back();
-    for(Move& move : checks) {
-        applyMoveWithUndo(move, undoStack.back());
-        if(kingAttackers != 0) {
-            moveList.emplace_back(move);
+    generateQuietChecks(moveList);
+    return moveList.size() - startSize;
+}
+
+int Board::generateQuietChecks(MoveList& moveList) {
+    const int startSize = moveList.size();
+    PrecomputedBinary& binary = PrecomputedBinary::getBinary();
+    const Color them = flipColor(turn);
+    const Square theirKing = getSquare(getLsb(pieces[King] & sides[them]));
+    const Bitboard occupiedBoard = sides[White] | sides[Black];
+    //our pieces that are all that stands between one of our sliders and their king
+    const Bitboard discoverers = getSliderBlockers(them, turn) & sides[turn];
+
+    //the king can't check them itself, only by getting out of the way (going anywhere off the line)
+    Bitboard king = pieces[King] & sides[turn];
+    if((king & discoverers) != 0) {
+        Square kingSquare = getSquare(getLsb(king));
+        addNonPawnNormalMoves(moveList, King, ~occupiedBoard & ~binary.getLineMask(kingSquare, theirKing), king, occupiedBoard);
+    }
+    //and in double check, king moves are all there are
+    if(isNonSingular(kingAttackers)) {
+        return moveList.size() - startSize;
+    }
+    if(kingAttackers == 0) {
+        //castling checks with the rook, or by moving the king or the rook out of the way, so just look at where everything ends up
+        MoveList castles;
+        addCastlingMoves(castles, occupiedBoard, false);
+        for(Move& move : castles) {
+            Square rookTo = getRookCastlingSquare(move.getFrom(), move.getTo());
+            Square kingTo = getKingCastlingSquare(move.getFrom(), move.getTo());
+            Bitboard castledBoard = (occupiedBoard ^ (1ull << move.getFrom()) ^ (1ull << move.getTo())) | (1ull << kingTo) | (1ull << rookTo);
+            Bitboard rooks = ((pieces[Rook] | pieces[Queen]) & sides[turn] & ~(1ull << move.getTo())) | (1ull << rookTo);
+            Bitboard bishops = (pieces[Bishop] | pieces[Queen]) & sides[turn];
+            if((binary.getRookAttacksFromSquare(theirKing, castledBoard) & rooks) != 0 || (binary.getBishopAttacksFromSquare(theirKing, castledBoard) & bishops) != 0) {
+                moveList.emplace_back(move);
+            }
         }
-        revertMove(undoStack.back());
     }
-    undoStack.pop_back();
+
+    //the same squares as generateAllQuietMoves: empty ones, or if we're in check, ones that block it
+    Bitboard targetSquares;
+    if(kingAttackers != 0) {
+        targetSquares = binary.getBetweenSquaresMask(getSquare(getLsb(king)), getSquare(getLsb(kingAttackers)));
+    } else {
+        targetSquares = ~occupiedBoard;
+    }
+
+    //pawns check by pushing onto a square that attacks the king, or by uncovering a slider (unless it's straight up the file they're on)
+    Bitboard pawns = pieces[Pawn] & sides[turn];
+    Bitboard discoveringPawns = pawns & discoverers & ~getFile(getFileIndexOfSquare(theirKing));
+    Bitboard pawnChecks = binary.getPawnAttacksFromSquare(theirKing, them);
+    Bitboard pawnsForwardOne = ~LastRanks & getPawnAdvances(pawns, occupiedBoard, turn);
+    Bitboard pawnsForwardTwo = getPawnAdvances(pawnsForwardOne & (turn == White ? Rank3 : Rank6), occupiedBoard, turn);
+    Bitboard discoveringForwardOne = getPawnAdvances(discoveringPawns, occupiedBoard, turn);
+    Bitboard discoveringForwardTwo = getPawnAdvances(discoveringForwardOne & (turn == White ? Rank3 : Rank6), occupiedBoard, turn);
+    addPawnMoves(moveList, pawnsForwardOne & targetSquares & (pawnChecks | discoveringForwardOne), turn == White ? -NumFiles : NumFiles);
+    addPawnMoves(moveList, pawnsForwardTwo & targetSquares & (pawnChecks | discoveringForwardTwo), turn == White ? -(2 * NumFiles) : (2 * NumFiles));
+
+    //everything else checks from where it would attack the king, or from anywhere off the line if it's uncovering a slider
+    const Bitboard knightChecks = binary.getKnightAttacksFromSquare(theirKing);
+    const Bitboard bishopChecks = binary.getBishopAttacksFromSquare(theirKing, occupiedBoard);
+    const Bitboard rookChecks = binary.getRookAttacksFromSquare(theirKing, occupiedBoard);
+    auto addChecks = [&](Piece type, Bitboard checks) {
+        Bitboard sources = pieces[type] & sides[turn];
+        while(sources != 0) {
+            Square from = getSquare(popLsb(sources));
+            Bitboard targets = targetSquares & checks;
+            if(testBit(discoverers, from)) {
+                targets |= targetSquares & ~binary.getLineMask(from, theirKing);
+            }
+            if(type == Knight) {
+                addNonPawnNormalMoves(moveList, Knight, targets, 1ull << from, occupiedBoard);
+            }
+            if(type == Bishop || type == Queen) {
+                addNonPawnNormalMoves(moveList, Bishop, targets, 1ull << from, occupiedBoard);
+            }
+            if(type == Rook || type == Queen) {
+                addNonPawnNormalMoves(moveList, Rook, targets, 1ull << from, occupiedBoard);
+            }
+        }
+    };
+    addChecks(Knight, knightChecks);
+    addChecks(Bishop, bishopChecks);
+    addChecks(Rook, rookChecks);
+    addChecks(Queen, bishopChecks | rookChecks);
     return moveList.size() - startSize;
 }
 
-int Board::generateAllQuietMoves(std::vector<Move>& moveList) {
+int Board::generateAllQuietMoves(MoveList& moveList) {
     const int startSize = moveList.size();
 
     Bitboard occupiedBoard = sides[White] | sides[Black];
@@ -1319,29 +1566,7 @@ int Board::generateAllQuietMoves(std::vector<Move>& moveList) {
     }
     //All pseudo-legal quiet king moves that aren't castling are just moving the king
     addNonPawnNormalMoves(moveList, King, ~occupiedBoard, sides[turn] & pieces[King], occupiedBoard);
-    //Castling (similar logic to isMovePseudoLegal)
-    Bitboard rookCopy = castlingRooks & sides[turn];
-    if(kingAttackers == 0) { //if we aren't in check
-        while(rookCopy != 0) {
-            Square rookFrom = getSquare(popLsb(rookCopy));
-            Square kingFrom = getSquare(getLsb(sides[turn] & pieces[King]));
-
-            Square rookTo = getRookCastlingSquare(kingFrom, rookFrom);
-            Square kingTo = getKingCastlingSquare(kingFrom, rookFrom);
-            
-            Bitboard betweenSquares = PrecomputedBinary::getBinary().getBetweenSquaresMask(kingFrom, kingTo) | PrecomputedBinary::getBinary().getBetweenSquaresMask(rookFrom, rookTo) | (1ull << kingTo) | (1ull << rookTo);
-            //don't count the squares they are on
-            betweenSquares &= ~((1ull << rookFrom) | (1ull << kingFrom));
-            if((occupiedBoard & betweenSquares) != 0) {
-                //we cannot castle here, as we pass through things
-                continue;
-            }
-            if(isSquareInBoardAttacked(PrecomputedBinary::getBinary().getBetweenSquaresMask(kingFrom, kingTo), turn)) {
-                continue; //we went through check
-            }
-            moveList.emplace_back(kingFrom, rookFrom, Move::MoveType::Castle);
-        }
-    }
+    addCastlingMoves(moveList, occupiedBoard, false);
 
     //If we are not in check, all the noncaptures (the remaining quiet moves) are just spots
     //on ~occupiedBoard. If we are in check, the only quiet way to get out is to block the piece
@@ -1365,7 +1590,63 @@ int Board::generateAllQuietMoves(std::vector<Move>& moveList) {
     return moveList.size() - startSize;
 }
 
-int Board::generateAllPseudoLegalMoves(std::vector<Move>& moveList) {
+void Board::addCastlingMoves(MoveList& moveList, Bitboard occupiedBoard, bool onlyLegal) {
+    //Castling (similar logic to isMovePseudoLegal)
+    Bitboard rookCopy = castlingRooks & sides[turn];
+    if(kingAttackers != 0) { //we can't castle out of check
+        return;
+    }
+    while(rookCopy != 0) {
+        Square rookFrom = getSquare(popLsb(rookCopy));
+        Square kingFrom = getSquare(getLsb(sides[turn] & pieces[King]));
+
+        Square rookTo = getRookCastlingSquare(kingFrom, rookFrom);
+        Square kingTo = getKingCastlingSquare(kingFrom, rookFrom);
+        
+        Bitboard betweenSquares = PrecomputedBinary::getBinary().getBetweenSquaresMask(kingFrom, kingTo) | PrecomputedBinary::getBinary().getBetweenSquaresMask(rookFrom, rookTo) | (1ull << kingTo) | (1ull << rookTo);
+        //don't count the squares they are on
+        betweenSquares &= ~((1ull << rookFrom) | (1ull << kingFrom));
+        if((occupiedBoard & betweenSquares) != 0) {
+            //we cannot castle here, as we pass through things
+            continue;
+        }
+        if(isSquareInBoardAttacked(PrecomputedBinary::getBinary().getBetweenSquaresMask(kingFrom, kingTo), turn)) {
+            continue; //we went through check
+        }
+        if(onlyLegal) {
+            //look at the destination with the king and rook already moved, since either could have been blocking something
+            Bitboard castledBoard = (occupiedBoard ^ (1ull << kingFrom) ^ (1ull << rookFrom)) | (1ull << kingTo) | (1ull << rookTo);
+            if((getAllSquareAttackers(castledBoard, kingTo) & sides[flipColor(turn)]) != 0) {
+                continue;
+            }
+        }
+        moveList.emplace_back(kingFrom, rookFrom, Move::MoveType::Castle);
+    }
+}
+
+void Board::addAllPawnMoves(MoveList& moveList, Bitboard pawns, Bitboard targets, Bitboard occupiedBoard) {
+    const int sideDirection = turn == White ? -1 : 1;
+    const int left = sideDirection * (NumFiles - 1);
+    const int right = sideDirection * (NumFiles + 1);
+    const int forward = sideDirection * NumFiles;
+
+    Bitboard forwardOne = getPawnAdvances(pawns, occupiedBoard, turn);
+    Bitboard forwardTwo = getPawnAdvances(forwardOne & (turn == White ? Rank3 : Rank6), occupiedBoard, turn);
+    Bitboard leftAttacks = getPawnLeftAttacks(pawns, sides[flipColor(turn)], turn) & targets;
+    Bitboard rightAttacks = getPawnRightAttacks(pawns, sides[flipColor(turn)], turn) & targets;
+    forwardOne &= targets;
+    forwardTwo &= targets;
+
+    addPawnPromotions(moveList, forwardOne & LastRanks, forward);
+    addPawnPromotions(moveList, leftAttacks & LastRanks, left);
+    addPawnPromotions(moveList, rightAttacks & LastRanks, right);
+    addPawnMoves(moveList, leftAttacks & ~LastRanks, left);
+    addPawnMoves(moveList, rightAttacks & ~LastRanks, right);
+    addPawnMoves(moveList, forwardOne & ~LastRanks, forward);
+    addPawnMoves(moveList, forwardTwo, 2 * forward);
+}
+
+int Board::generateAllPseudoLegalMoves(MoveList& moveList) {
     const int startSize = moveList.size();
 
     generateAllNoisyMoves(moveList);
@@ -1374,32 +1655,113 @@ int Board::generateAllPseudoLegalMoves(std::vector<Move>& moveList) {
     return moveList.size() - startSize;
 }
 
-int Board::generateAllLegalMoves(std::vector<Move>& moveList) {
+int Board::generateAllLegalMoves(MoveList& moveList) {
     const int startSize = moveList.size();
-    std::vector<Move> pseudoLegalMoves;
-    pseudoLegalMoves.reserve(MaxNumMoves);
+    const Bitboard occupiedBoard = sides[White] | sides[Black];
+    const Bitboard enemies = sides[flipColor(turn)];
+    const Square kingSquare = getSquare(getLsb(pieces[King] & sides[turn]));
+
+    //The king can go anywhere not attacked, once it has left its square (otherwise it would shield the squares behind it from sliders)
+    Bitboard kingTargets = PrecomputedBinary::getBinary().getKingAttacksFromSquare(kingSquare) & ~sides[turn];
+    while(kingTargets != 0) {
+        Square to = getSquare(popLsb(kingTargets));
+        if((getAllSquareAttackers(occupiedBoard ^ (1ull << kingSquare), to) & enemies) == 0) {
+            moveList.emplace_back(kingSquare, to, Move::MoveType::Normal);
+        }
+    }
+    //In double check, moving the king is all there is
+    if(isNonSingular(kingAttackers)) {
+        return moveList.size() - startSize;
+    }
 
-    generateAllPseudoLegalMoves(pseudoLegalMoves);
+    //Everything else has to capture or block a checker if there is one
+    Bitboard checkMask = ~sides[turn];
+    if(kingAttackers != 0) {
+        checkMask &= kingAttackers | PrecomputedBinary::getBinary().getBetweenSquaresMask(kingSquare, getSquare(getLsb(kingAttackers)));
+    } else {
+        addCastlingMoves(moveList, occupiedBoard, true);
+    }
+
+    //and pinned pieces have to stay on the line through the king and whatever pins them
+    //(knights can never do that, and the rest are done one at a time below)
+    const Bitboard pinned = getPinnedPieces();
+    addAllPawnMoves(moveList, pieces[Pawn] & sides[turn] & ~pinned, checkMask, occupiedBoard);
+    addNonPawnNormalMoves(moveList, Knight, checkMask, pieces[Knight] & sides[turn] & ~pinned, occupiedBoard);
+    addNonPawnNormalMoves(moveList, Bishop, checkMask, (pieces[Bishop] | pieces[Queen]) & sides[turn] & ~pinned, occupiedBoard);
+    addNonPawnNormalMoves(moveList, Rook, checkMask, (pieces[Rook] | pieces[Queen]) & sides[turn] & ~pinned, occupiedBoard);
+
+    Bitboard pinnedMovers = pinned & ~pieces[Knight];
+    while(pinnedMovers != 0) {
+        Square from = getSquare(popLsb(pinnedMovers));
+        Bitboard targets = checkMask & PrecomputedBinary::getBinary().getLineMask(kingSquare, from);
+        switch(getPieceType(squares[from])) {
+            case Pawn:
+                addAllPawnMoves(moveList, 1ull << from, targets, occupiedBoard);
+                break;
+            case Bishop:
+                addNonPawnNormalMoves(moveList, Bishop, targets, 1ull << from, occupiedBoard);
+                break;
+            case Rook:
+                addNonPawnNormalMoves(moveList, Rook, targets, 1ull << from, occupiedBoard);
+                break;
+            case Queen:
+                addNonPawnNormalMoves(moveList, Bishop, targets, 1ull << from, occupiedBoard);
+                addNonPawnNormalMoves(moveList, Rook, targets, 1ull << from, occupiedBoard);
+                break;
+            default:
+                assert(false);
+        }
+    }
 
-    undoStack.emplace_back();
-    for(Move& move : pseudoLegalMoves) {
-        //check legality
-        applyMoveWithUndo(move, undoStack.back());
-        if(!didLastMoveLeaveInCheck()) {
-            moveList.emplace_back(move);
+    //En passant is rare and awkward enough to just check directly
+    Bitboard enpassantSources = getPawnEnpassantCaptures(sides[turn] & pieces[Pawn], enpassantSquare, turn);
+    while(enpassantSources != 0) {
+        Square from = getSquare(popLsb(enpassantSources));
+        if(!doesEnpassantLeaveInCheck(from)) {
+            moveList.emplace_back(from, enpassantSquare, Move::MoveType::Enpassant);
         }
-        revertMove(undoStack.back());
     }
-    undoStack.pop_back();
 
     return moveList.size() - startSize;
 }
 
+bool Board::doesEnpassantLeaveInCheck(Square from) const {
+    Square kingSquare = getSquare(getLsb(pieces[King] & sides[turn]));
+    Square capturedSquare = getSquare(turn == White ? enpassantSquare - NumFiles : enpassantSquare + NumFiles);
+    //the board as it would be after the capture
+    Bitboard occupiedBoard = ((sides[White] | sides[Black]) ^ (1ull << from) ^ (1ull << capturedSquare)) | (1ull << enpassantSquare);
+    Bitboard attackers = getAllSquareAttackers(occupiedBoard, kingSquare) & sides[flipColor(turn)] & ~(1ull << capturedSquare);
+    return attackers != 0;
+}
+
+Bitboard Board::getPinnedPieces() const {
+    return getSliderBlockers(turn, flipColor(turn)) & sides[turn];
+}
+
+Bitboard Board::getSliderBlockers(Color kingSide, Color sliderSide) const {
+    Square kingSquare = getSquare(getLsb(pieces[King] & sides[kingSide]));
+    Bitboard occupiedBoard = sides[White] | sides[Black];
+    Bitboard sliders = sides[sliderSide];
+    //the sliders that would attack the king if nothing was in the way
+    Bitboard snipers = (PrecomputedBinary::getBinary().getBishopAttacksFromSquare(kingSquare, 0) & sliders & (pieces[Bishop] | pieces[Queen]))
+                     | (PrecomputedBinary::getBinary().getRookAttacksFromSquare(kingSquare, 0) & sliders & (pieces[Rook] | pieces[Queen]));
+    Bitboard blockers = 0;
+    while(snipers != 0) {
+        Bitboard between = PrecomputedBinary::getBinary().getBetweenSquaresMask(kingSquare, getSquare(popLsb(snipers))) & occupiedBoard;
+        //exactly one piece in the way
+        if(between != 0 && !isNonSingular(between)) {
+            blockers |= between;
+        }
+    }
+    return blockers;
+}
+
 Move Board::getLastPlayedMove() const {
-    if(undoStack.size() == 0) {
+    const UndoData* undo = getLastUndo();
+    if(undo == nullptr) {
         return Move{};
     }
-    return undoStack.back().move;
+    return undo->move;
 }
 
 int Board::getPlies() const {
@@ -1411,13 +1773,14 @@ int Board::getTotalPlies() const {
 }
 
 Piece Board::getLastMovedPiece() const {
-    if(undoStack.back().move.getMoveType() == Move::Castle) {
+    const Move& move = getLastUndo()->move;
+    if(move.getMoveType() == Move::Castle) {
         return King;
     }
-    if(squares[undoStack.back().move.getTo()] == Empty) {
+    if(squares[move.getTo()] == Empty) {
         std::cout << "HERE" << std::endl;
     }
-    return getPieceType(squares[undoStack.back().move.getTo()]);
+    return getPieceType(squares[move.getTo()]);
 }
 
 bool Board::isCurrentTurnInCheck() const {
@@ -1428,6 +1791,42 @@ bool Board::isMoveTactical(const Move& move) {
     return (move.getMoveType() == Move::Enpassant || move.getMoveType() == Move::Promotion) || (squares[move.getTo()] != Empty && move.getMoveType() != Move::Castle);
 }
 
+bool Board::givesCheck(const Move& move) const {
+    PrecomputedBinary& binary = PrecomputedBinary::getBinary();
+    Square theirKing = getSquare(getLsb(pieces[King] & sides[flipColor(turn)]));
+    Bitboard occupiedBoard = sides[White] | sides[Black];
+    Square from = move.getFrom();
+    Square to = move.getTo();
+    switch(move.getMoveType()) {
+        case Move::Castle: {
+            //the rook can check, and so can anything the king or rook got out of the way of
+            Square kingTo = getKingCastlingSquare(from, to);
+            Square rookTo = getRookCastlingSquare(from, to);
+            Bitboard castledBoard = (occupiedBoard ^ (1ull << from) ^ (1ull << to)) | (1ull << kingTo) | (1ull << rookTo);
+            Bitboard rooks = ((pieces[Rook] | pieces[Queen]) & sides[turn] & ~(1ull << to)) | (1ull << rookTo);
+            return (binary.getRookAttacksFromSquare(theirKing, castledBoard) & rooks) != 0
+                || (binary.getBishopAttacksFromSquare(theirKing, castledBoard) & (pieces[Bishop] | pieces[Queen]) & sides[turn]) != 0;
+        }
+        case Move::Enpassant: {
+            //two pawns leave their squares, so either could uncover something
+            Square captured = move.getEnpassantSquareCaptured(turn);
+            Bitboard capturedBoard = (occupiedBoard ^ (1ull << from) ^ (1ull << captured)) | (1ull << to);
+            return testBit(binary.getPawnAttacksFromSquare(to, turn), theirKing)
+                || (binary.getRookAttacksFromSquare(theirKing, capturedBoard) & (pieces[Rook] | pieces[Queen]) & sides[turn]) != 0
+                || (binary.getBishopAttacksFromSquare(theirKing, capturedBoard) & (pieces[Bishop] | pieces[Queen]) & sides[turn]) != 0;
+        }
+        default: {
+            Piece piece = move.getMoveType() == Move::Promotion ? move.getPromoType() : getPieceType(squares[from]);
+            Bitboard movedBoard = (occupiedBoard ^ (1ull << from)) | (1ull << to);
+            if(testBit(getPieceAttacksFromSquare(piece, to, movedBoard, turn), theirKing)) {
+                return true;
+            }
+            //(the board still has the moving piece on `from`, so it mustn't count as a slider behind itself)
+            return (getSliderAttackersThrough(from, theirKing, movedBoard, turn) & ~(1ull << from)) != 0;
+        }
+    }
+}
+
 bool Board::currentSideAboutToPromote() const {
     return (pieces[Pawn] & sides[turn] & (turn == White ? Rank7 : Rank2)) != 0;
 }
@@ -1440,10 +1839,18 @@ uint64_t Board::getBoardHash() const {
     return positionHash;
 }
 
-int Board::getCurrentPsqt() const {
+uint64_t Board::getPawnHash() const {
+    return pawnHash;
+}
+
+PackedScore Board::getCurrentPsqt() const {
     return currentEval;
 }
 
+int Board::getGamePhase() const {
+    return gamePhase;
+}
+
 bool Board::isBoardMaterialDraw() const {
     //never a draw with pawns or queens
     if(pieces[Pawn] != 0 || pieces[Queen] != 0) {
@@ -1489,48 +1896,37 @@ bool Board::isFileSemiOpen(Color side, Index fileIndex) const {
     return (getFile(fileIndex) & pieces[Pawn] & sides[side]) == 0;
 }
 
+Bitboard Board::getOpenFiles() const {
+    return ~getFileFill(pieces[Pawn]);
+}
+
+Bitboard Board::getSemiOpenFiles(Color side) const {
+    return ~getFileFill(pieces[Pawn] & sides[side]);
+}
+
+Bitboard Board::getPieces(Color side, Piece piece) const {
+    return pieces[piece] & sides[side];
+}
+
 int Board::getNumberOfIsolatedPawns(Color side) const {
     Bitboard pawns = pieces[Pawn] & sides[side];
-    int count = 0;
-    while(pawns != 0) {
-        Square square = getSquare(popLsb(pawns));
-        if((PrecomputedBinary::getBinary().getAdjacentFilesMask(getFileIndexOfSquare(square)) & pieces[Pawn] & sides[side]) == 0) {
-            count++;
-        }
-    }
-    return count;
+    return popCnt(pawns & ~getAdjacentFiles(getFileFill(pawns)));
 }
 
 int Board::getNumberOfPassedPawns(Color side) const {
-    Bitboard pawns = pieces[Pawn] & sides[side];
-    int count = 0;
-    while(pawns != 0) {
-        Square square = getSquare(popLsb(pawns));
-        if((PrecomputedBinary::getBinary().getPassedPawnMask(side, square) & pieces[Pawn] & sides[flipColor(side)]) == 0) {
-            count++;
-        }
-    }
-    return count;
+    return popCnt(getPassedPawns(side));
+}
+
+Bitboard Board::getPassedPawns(Color side) const {
+    //a pawn is passed unless it is in front of (or on a file next to and in front of) an enemy pawn, from their point of view
+    Bitboard enemyFrontSpans = getFrontSpans(flipColor(side), pieces[Pawn] & sides[flipColor(side)]);
+    return pieces[Pawn] & sides[side] & ~(enemyFrontSpans | getAdjacentFiles(enemyFrontSpans));
 }
 
 int Board::getNumberOfPiecesOnOpenFile(Color side, Piece piece) const {
-    Bitboard pieceBoard = pieces[piece] & sides[side];
-    int count = 0;
-    while(pieceBoard != 0) {
-        if(isFileOpen(getFileIndexOfSquare(getSquare(popLsb(pieceBoard))))) {
-            count++;
-        }
-    }
-    return count;
+    return popCnt(pieces[piece] & sides[side] & getOpenFiles());
 }
 
 int Board::getNumberOfPiecesOnSemiOpenFile(Color side, Piece piece) const {
-    Bitboard pieceBoard = pieces[piece] & sides[side];
-    int count = 0;
-    while(pieceBoard != 0) {
-        if(isFileSemiOpen(side, getFileIndexOfSquare(getSquare(popLsb(pieceBoard))))) {
-            count++;
-        }
-    }
-    return count;
+    return popCnt(pieces[piece] & sides[side] & getSemiOpenFiles(side));
 }
@@ -6,11 +6,43 @@
 #include <array>
 #include <vector>
 #include <map>
+#include <memory>
+#include <type_traits>
 #include "constants.h"
 #include "move.h"
+#include "movelist.h"
+#include "nnue.h"
 
 typedef uint64_t Bitboard;
 
+/**
+ * Everything about a position that changes as moves are made, as plain data in a few cache lines,
+ * so that saving it before a move and restoring it after (copy-make) is a single copy.
+ * The Board is this plus the things that are bigger or don't need restoring, like its history and the network accumulator.
+ */
+struct Position {
+    std::array<ColorPiece, NumSquares> squares;
+    //Bitboards for each of the pieces
+    std::array<Bitboard, 6> pieces;
+    //Bitboards for each side's pieces
+    std::array<Bitboard, 2> sides;
+    uint64_t positionHash;
+    uint64_t pawnHash;
+    //Bitboard for where the king is attacked from
+    Bitboard kingAttackers;
+    //Bitboards corresponding to rooks that can castle (non promoted ones)
+    Bitboard castlingRooks;
+    //Current track of piece values, and of the game phase
+    PackedScore currentEval;
+    int gamePhase;
+    //the current turn, half move counter (called plies in chess programming land), and full move counter (1 move = 2 plies)
+    Color turn;
+    int plies;
+    int fullmoves;
+    Square enpassantSquare;
+};
+static_assert(std::is_trivially_copyable<Position>::value && sizeof(Position) <= 192, "Position has to stay cheap to copy");
+
 /**g
  * The main board class that represents a current board position which is allowed to be ___PSEUDO-LEGAL___
  * (which means that it is either a legal position or a position that arose from a legal position where a side left their king in check, which is illegal)
@@ -18,7 +50,7 @@ typedef uint64_t Bitboard;
  * having a state true or false (like if a knight is on the square or not).
  * As a chessprogramming housekeeping note, we use LERF bitboard convention (little endian rank file).
  */ 
-class Board {
+class Board : private Position {
 public:
     enum BoardLegality {
         Legal = 0, IllegalKings, IllegalKingPosition, IllegalPawns, IllegalEnpassant
@@ -80,6 +112,10 @@ public:
         return files[index];
     }
 
+    static inline Rank getBackRank(Color side) {
+        return side == White ? Rank1 : Rank8;
+    }
+
     /**
      * Convert between squares and rank/files
      */ 
@@ -114,6 +150,26 @@ public:
      */ 
     static Board createBoardFromFEN(std::string fen);
     void validateLegality();
+    /**
+     * A board with this position but none of the moves that led to it (so it can't see repetitions of earlier positions):
+     * copying one is a copy of the Position and nothing else, for perft workers and the like. It has no search stack,
+     * so it can't make moves with applyMove.
+     */
+    Board clonePosition() const;
+    /**
+     * A board to search this position from on another thread: the Position, accumulator, the keys that can still be
+     * repeated and the last move played, with a search stack of its own. Only for a board with nothing on its search stack.
+     */
+    Board cloneForSearch() const;
+    /**
+     * Copying a board copies the position and the game played so far, but not the search stack: a copy allocates one of its own
+     * the first time it makes a move with applyMove, and assigning over a board keeps the one it has.
+     * Only for boards with nothing on their search stacks.
+     */
+    Board(const Board& board);
+    Board& operator=(const Board& board);
+    Board(Board&& board) = default;
+    Board& operator=(Board&& board) = default;
 
     std::string getFEN() const;
     ColorPiece getPieceAt(Square square) const;
@@ -124,39 +180,77 @@ public:
     void evalAddPiece(ColorPiece piece, Square location);
     void evalRemovePiece(ColorPiece piece, Square location);
     void initMaterialEval();
-    CentipawnScore getCurrentPsqt() const;
+    void initPawnHash();
+    PackedScore getCurrentPsqt() const;
+    /**
+     * How much non-pawn material is left, from MaxGamePhase in the opening down to 0 (it can go over with promotions).
+     */
+    int getGamePhase() const;
+    /**
+     * The network's accumulator for this position, refreshing whichever side's half is stale first.
+     * Boards only keep it updated once this has been called (so it costs nothing when the network isn't used).
+     */
+    const Network::Accumulator& getAccumulator() const;
 
     bool hasNonPawns(Color side) const;
     bool isDrawn() const;
+    /**
+     * The search's version: a position repeated since the search started (searchPly moves ago)
+     * is already a draw, since whatever made it worth repeating once makes it worth repeating again.
+     */
+    bool isDrawn(int searchPly) const;
     bool isFiftyMoveRuleDraw() const;
     bool isThreefoldDraw() const;
+    bool isRepetition(int searchPly) const;
+    /**
+     * Whether the side to move has a move back to a position it was in earlier (counted the same way as isRepetition),
+     * so it can force a draw at the very least. Found through ZobristNums' cuckoo table rather than by trying moves,
+     * which means the move might not be legal (it could leave the king in check), as with other engines that do this.
+     */
+    bool hasUpcomingRepetition(int searchPly) const;
     bool isInsufficientMaterialDraw() const;
    
     /**
      * Returns number of moves added to the vector. 
      */
-    int generateAllLegalMoves(std::vector<Move>& moveList);
+    int generateAllLegalMoves(MoveList& moveList);
     /**
      *  Returns number of moves add to vector THAT ARE PSEUDO-LEGAL.
      */
-    int generateAllPseudoLegalMoves(std::vector<Move>& moveList);
+    int generateAllPseudoLegalMoves(MoveList& moveList);
     /**
      * A "noisy" move is a capture, promotion, pawn push.
      * Returns number of moves added to vector THAT ARE PSEUDO-LEGAL.
      */
-    int generateAllNoisyMoves(std::vector<Move>& moveList);
+    int generateAllNoisyMoves(MoveList& moveList);
 
-    int generateAllNoisyMovesAndChecks(std::vector<Move>& moveList);
+    /**
+     * The noisy moves, then the quiet moves that give check.
+     */
+    int generateAllNoisyMovesAndChecks(MoveList& moveList);
     /**
      * A quiet move is what's left from the list above.
      * Returns number of moves added to vector THAT ARE PSEUDO-LEGAL.
      */
-    int generateAllQuietMoves(std::vector<Move>& moveList);
+    int generateAllQuietMoves(MoveList& moveList);
+    /**
+     * The quiet moves that give check, either directly or by getting out of the way of one of our sliders.
+     * Worked out from the squares each piece would give check from, without making any moves.
+     * Returns number of moves added to vector THAT ARE PSEUDO-LEGAL.
+     */
+    int generateQuietChecks(MoveList& moveList);
 
     void setSquare(Color color, Piece piece, Square square);
     void clearSquare(Square square);
     
+    /**
+     * Takes back the most recent move made with applyMove.
+     */
     void revertMostRecent();
+    /**
+     * Takes back the most recent move played with playMove, when nothing is on the search stack.
+     */
+    void revertPlayedMove();
     
     bool setCastlingRight(Color side, bool kingside);
     bool clearCastlingRight(Color side, bool kingside);
@@ -171,8 +265,14 @@ public:
     
     /**
      * Returns whether or not the move was legal (if it was not, it rejects the move)
+     * The move goes on the search stack, so it's for looking ahead: at most MaxDepth of them, each taken back with revertMostRecent.
      */ 
     bool applyMove(Move& move);
+    /**
+     * The same, but for a move the game itself plays: it goes into the game's history rather than the search stack
+     * (which has to be empty), so games can be as long as they like.
+     */
+    bool playMove(Move& move);
     int countLegalMoves();
 
     bool isMoveLegal(Move& move);
@@ -189,6 +289,10 @@ public:
     
     Move getLastPlayedMove() const;
     bool isMoveTactical(const Move& move);
+    /**
+     * Whether the (pseudo-legal) move puts the other side in check, worked out without making it.
+     */
+    bool givesCheck(const Move& move) const;
     bool currentSideAboutToPromote() const;
     bool currentSideHasPiece(Piece piece) const;
     /**
@@ -197,29 +301,42 @@ public:
     bool isBoardMaterialDraw() const;
     
     int getSidePieceCount(Color side, Piece piece) const;
+    Bitboard getPieces(Color side, Piece piece) const;
     bool isFileOpen(Index fileIndex) const;
     bool isFileSemiOpen(Color side, Index fileIndex) const;
+    /**
+     * Every square on a file with no pawns at all (or none of the side's own, for semi-open).
+     * Cheap enough to work out once per evaluation and then mask pieces against.
+     */
+    Bitboard getOpenFiles() const;
+    Bitboard getSemiOpenFiles(Color side) const;
     int getNumberOfPiecesOnOpenFile(Color side, Piece piece) const;
     int getNumberOfPiecesOnSemiOpenFile(Color side, Piece piece) const;
     int getNumberOfIsolatedPawns(Color side) const;
     int getNumberOfPassedPawns(Color side) const;
+    Bitboard getPassedPawns(Color side) const;
 
     int getPlies() const;
     int getTotalPlies() const;
     Piece getLastMovedPiece() const;
     BoardLegality getBoardLegalityState() const;
     uint64_t getBoardHash() const;
-
-    bool isSquareAttacked(Square square, Color side); // the side of the piece on the square, not the attacking team.
     /**
-     * Runs a PERFormance Tree test, which brute force generates all possible legal moves in the next *depth* nodes
-     * from the current board state. Leaves the board in the state it was in prior.
-     * Good for benchmarks and move generation correctness tests. 
+     * A Zobrist hash of just the pawns, for caching pawn structure evaluation
+     * (which rarely changes from one position to the next).
      */
-    void perftTest(int depth);
+    uint64_t getPawnHash() const;
+
+    bool isSquareAttacked(Square square, Color side); // the side of the piece on the square, not the attacking team.
 private:
     //For static exchange evaluation
     friend class HeuristicMoveOrderer;
+    //For making and unmaking moves without the undo stack
+    friend class Perft;
+    friend class Microbenchmark;
+    //For hashing positions from scratch
+    friend class ZobristNums;
+    friend class OpeningBook;
     
     bool validationRun = false;
     /**
@@ -231,6 +348,8 @@ private:
 	    Bitboard shift;
 	    //this points to the BishopAttack/RookAttack arrays
 	    Bitboard* offset;
+	    //and this to the same attacks in the BishopPextAttack/RookPextAttack arrays
+	    Bitboard* pextOffset;
     };
     /**
      * Your friendly neighbourhood singleton of computation stuff.
@@ -256,6 +375,17 @@ private:
         Bitboard getRookAttacksFromSquare(Square square, Bitboard occupiedBoard);
         Bitboard getQueenAttacksFromSquare(Square square, Bitboard occupiedBoard);
         Bitboard getBetweenSquaresMask(Square square1, Square square2);
+        /**
+         * The whole rank, file or diagonal through both squares (edge to edge), or nothing if they don't share one.
+         */
+        Bitboard getLineMask(Square square1, Square square2);
+        /**
+         * Switches the sliding piece attacks between the PEXT and magic tables (they give identical results).
+         * PEXT is picked automatically when the CPU has fast BMI2, so this is just for comparing them.
+         * Returns false (and keeps magics) if the CPU can't do PEXT.
+         */
+        bool setPextEnabled(bool enabled);
+        bool isPextEnabled() const;
         Bitboard getAdjacentFilesMask(Index fileIndex);
         Bitboard getPassedPawnMask(Color side, Square square);
     private: 
@@ -266,6 +396,7 @@ private:
          */
         
         MultiArray<Bitboard, NumSquares, NumSquares> BetweenSquaresMasks;
+        MultiArray<Bitboard, NumSquares, NumSquares> LineMasks;
         std::array<Bitboard, NumFiles> AdjacentFilesMasks;
         MultiArray<Bitboard, NumColors, NumSquares> PassedPawnMasks;
         /**
@@ -320,6 +451,27 @@ private:
         //these are the hash tables, indexed by square
         alignas(64) HashEntry BishopTable[NumSquares];
         alignas(64) HashEntry RookTable[NumSquares];
+        /**
+         * The other way of indexing the attack tables: PEXT (from BMI2) gathers exactly the masked occupancy bits into the low bits of the index,
+         * so no multiplier is needed. It's faster where PEXT is, which is everywhere with BMI2 except AMD before Zen 3 (where it is microcoded and very slow).
+         * It's written as inline assembly rather than the intrinsic so that it inlines into code compiled without -mbmi2,
+         * which is fine since it's only ever run after checking the CPU.
+         */
+        bool pextAvailable = false;
+        bool usePext = false;
+        alignas(64) Bitboard BishopPextAttack[0x1480];
+        alignas(64) Bitboard RookPextAttack[0x19000];
+        void populatePextTable(HashEntry* table, Square square, Bitboard* attacks, const MultiArray<int, 4, 2>& movementDelta);
+        static inline Bitboard parallelBitsExtract(Bitboard bits, Bitboard mask) {
+#if defined(__x86_64__)
+            Bitboard result;
+            asm("pextq %2, %1, %0" : "=r"(result) : "r"(bits), "r"(mask));
+            return result;
+#else
+            assert(false);
+            return 0;
+#endif
+        }
         Bitboard calculateRookBishopAttacks(Square square, Bitboard occupiedBoard, const MultiArray<int, 4, 2>& movementDelta);
         void populateHashTable(HashEntry* table, Square square, Bitboard hash, const MultiArray<int, 4, 2>& movementDelta);
         inline int computeHashTableIndex(Bitboard occupiedBoard, HashEntry& entry) {
@@ -328,61 +480,79 @@ private:
     };
     Board(); //private constructor to force client to use factory method
 
-    std::array<ColorPiece, NumSquares> squares;
-    uint64_t positionHash;
-    //Bitboards for each of the pieces
-    std::array<Bitboard, 6> pieces;
-    //Bitboards for each side's pieces
-    std::array<Bitboard, 2> sides;
-    //Bitboard for where the king is attacked from
-    Bitboard kingAttackers;
-    //Bitboards corresponding to rooks that can castle (non promoted ones)
-    Bitboard castlingRooks;
-    std::array<Bitboard, NumSquares> castleMasks;
-    //Current track of piece values
-    CentipawnScore currentEval;
-
-    //the current turn, half move counter (called plies in chess programming land), and full move counter (1 move = 2 plies)
-    Color turn;
-    int plies;
-    int fullmoves;
-    Square enpassantSquare;   
-
-
-    unsigned long long perft(std::map<std::string, int>& divideTree, int depth, int& enpassant, int& promotions, int& castles);
-    int perftRootDepth;
+    //The network accumulator (its values from before each move made with it up to date are kept on the search stack)
+    mutable Network::Accumulator accumulator;
+    void updateAccumulator(ColorPiece piece, Square location, bool add);
+    void refreshAccumulator(Color perspective) const;
 
     /**
      * All of these methods take every square on the given Bitboard as a target square (iterating over them),
      * and add them to the movelist (where the from is as specified, done implicity for pawns)
     */
-    void addEnpassantMoves(std::vector<Move>& moveList, Bitboard sources, Square enpassantSquare);
-    void addPawnMoves(std::vector<Move>& moveList, Bitboard targets, int directionPawnIsIn);
-    void addPawnPromotions(std::vector<Move>& moveList, Bitboard targets, int directionPawnIsIn);
+    void addEnpassantMoves(MoveList& moveList, Bitboard sources, Square enpassantSquare);
+    void addPawnMoves(MoveList& moveList, Bitboard targets, int directionPawnIsIn);
+    void addPawnPromotions(MoveList& moveList, Bitboard targets, int directionPawnIsIn);
     /**
      *  Helper function used by the below two functions once they have their stuff figured out
      */
-    void addNormalMoves(std::vector<Move>& moveList, Bitboard targets, Square from);
+    void addNormalMoves(MoveList& moveList, Bitboard targets, Square from);
     /**
      * type must be Knight, Bishop, Rook, King, will error otherwise 
      */
-    void addNonPawnNormalMoves(std::vector<Move>& moveList, Piece type, Bitboard targets, Bitboard sources, Bitboard occupiedBoard);
+    void addNonPawnNormalMoves(MoveList& moveList, Piece type, Bitboard targets, Bitboard sources, Bitboard occupiedBoard);
+    /**
+     * Every non-enpassant pawn move (pushes, captures and promotions) of the given pawns that lands on targets.
+     */
+    void addAllPawnMoves(MoveList& moveList, Bitboard pawns, Bitboard targets, Bitboard occupiedBoard);
+    /**
+     * Castling moves whose path is clear, and that don't start in, go through or end up in check.
+     * If onlyLegal is false, it doesn't check where the king ends up (leaving that to whoever makes the move).
+     */
+    void addCastlingMoves(MoveList& moveList, Bitboard occupiedBoard, bool onlyLegal);
 
     bool debugIsSquareAttacked(Square square, Color side);
     /**
      * Some annoying to recompute data for undoing a move
      */ 
     struct UndoData {
-        uint64_t positionHash;
-	    Bitboard kingAttackers;
-	    Bitboard castlingRooks;
-	    Square enpassantSquare;
-	    int plies;
-	    CentipawnScore currentEval;
-	    ColorPiece pieceCaptured;
+        //the position before the move, to go back to
+        Position position;
         Move move;
+	    ColorPiece pieceCaptured;
+	    bool accumulatorSaved;
+    };
+    /**
+     * The moves made with applyMove on top of the game, a ply each. It's a fixed size, allocated once for boards that are set up to
+     * play (by createBoardFromFEN and cloneForSearch, or by the first move a copy makes), so making and unmaking moves never
+     * allocates, and clones and copies don't carry it around. undoCount is how much of it is in use.
+     * The accumulator from before the move in undo[i] is in accumulators[i], if it was up to date.
+     */
+    struct SearchStack {
+        std::array<UndoData, MaxDepth> undo;
+        std::array<Network::Accumulator, MaxDepth> accumulators;
     };
-    std::vector<UndoData> undoStack;
+    std::unique_ptr<SearchStack> searchStack;
+    int undoCount = 0;
+    UndoData& pushUndo();
+    /**
+     * The moves the game has played with playMove, oldest first, so they can be taken back.
+     */
+    std::vector<UndoData> gameHistory;
+    /**
+     * The last move made, on the search stack or failing that in the game, or nullptr if there isn't one.
+     */
+    const UndoData* getLastUndo() const;
+
+    /**
+     * The hash of the position before every move made (either way), oldest first, for spotting repetitions.
+     * Only the last `plies` of them can be repeated, since a capture or a pawn move can't be undone.
+     * There's always room for MaxDepth more than the game has played, so the search never reallocates it.
+     */
+    std::vector<uint64_t> keyHistory;
+    /**
+     * Whether the position keyHistory[index] had come up before, within the `reversible` moves made before it.
+     */
+    bool wasRepeatedAt(int index, int reversible) const;
 
     static Square getKingCastlingSquare(Square king, Square rook);
     static Square getRookCastlingSquare(Square king, Square rook);
@@ -395,14 +565,42 @@ private:
     void applyPromotionMoveWithUndo(Move& move, UndoData& undo);
 
     /**
-     * This takes the most recent element of the undo stack
+     * Goes back to the position in undo. The accumulator is left stale, it's up to the caller to restore it if it was saved.
      */
     void revertMove(UndoData& undo);
 
+    /**
+     * The current side's pieces that are pinned to their king (moving them off the line to the king would expose it).
+     */
+    Bitboard getPinnedPieces() const;
+    /**
+     * The pieces (of either side) that are the only thing between kingSide's king and one of sliderSide's sliders.
+     * With sliderSide the other side, ours among them are pinned. With sliderSide our own, ours among them give
+     * discovered check by moving off the line.
+     */
+    Bitboard getSliderBlockers(Color kingSide, Color sliderSide) const;
+    /**
+     * Whether capturing en passant with the pawn on `from` would leave our king in check, which, besides the usual pins,
+     * can happen when both pawns leaving the same rank uncovers a rook or queen.
+     */
+    bool doesEnpassantLeaveInCheck(Square from) const;
     bool isSquareInBoardAttacked(Bitboard board, Color turn);
     //With these, we can do what is necessary to determine all the attacks
     Bitboard getAllSquareAttackers(Bitboard occupiedBoard, Square square) const;
     Bitboard getAllKingAttackers();
+    /**
+     * After a normal move or a promotion, the only things that can be attacking the king of the side now to move
+     * are the piece that moved and a slider it got out of the way of, so there's no need to look for anything else.
+     */
+    Bitboard getKingAttackersAfterMove(const Move& move) const;
+    /**
+     * What a piece of the given type (and side, for pawns) on the square attacks.
+     */
+    static Bitboard getPieceAttacksFromSquare(Piece piece, Square square, Bitboard occupiedBoard, Color side);
+    /**
+     * side's sliders attacking target through `from`, with the board as occupiedBoard (so once whatever was on `from` has left).
+     */
+    Bitboard getSliderAttackersThrough(Square from, Square target, Bitboard occupiedBoard, Color side) const;
 
     //Some special things for pawns (their rules are weird)
     static Bitboard getPawnLeftAttacks(Bitboard pawnBoard, Bitboard targets, Color side);
@@ -427,6 +625,13 @@ private:
      * Does the bitboard contain more than one 1, just a faster version of popCnt > 1
      */ 
     static bool isNonSingular(Bitboard bb);
+    /**
+     * Set-wise pawn structure helpers, working on every bit of the board at once:
+     * the files that have anything on them, those files' neighbours, and the squares strictly in front of anything (from side's point of view).
+     */
+    static Bitboard getFileFill(Bitboard bb);
+    static Bitboard getAdjacentFiles(Bitboard files);
+    static Bitboard getFrontSpans(Color side, Bitboard bb);
 
     static void setBit(Bitboard& bb, Square bit);
     static void clearBit(Bitboard& bb, Square bit);
@@ -0,0 +1,72 @@
+#ifndef _BOOK_H
+#define _BOOK_H
+
+#include "board.h"
+#include "move.h"
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+
+/**
+ * An opening book in Polyglot's .bin layout: 16 byte entries of a position key, a move, a weight and a learn field
+ * (which we ignore), all big-endian and sorted by key, with every move known for a position stored next to each other.
+ *
+ * The file is memory-mapped read-only and never copied, so one book can be shared by every game and search thread at once
+ * (it's immutable once opened, so nothing needs locking). Looking a position up is a binary search on the key,
+ * and the move played is picked at random in proportion to the weights.
+ *
+ * Positions are keyed the way Polyglot keys them, so books made by other tools work here and ones made by build() work there.
+ */
+class OpeningBook {
+public:
+    /**
+     * Maps the book file in, or gives back nullptr if it can't be read or isn't a book.
+     */
+    static std::shared_ptr<const OpeningBook> open(const std::string& path);
+    ~OpeningBook();
+    OpeningBook(const OpeningBook& other) = delete;
+    OpeningBook& operator=(const OpeningBook& other) = delete;
+
+    /**
+     * A book move for the position, picked at random by weight, or a null move if the book doesn't know it.
+     * The move is checked to be legal here, so a bad entry (or one for another position with the same key) is never played.
+     */
+    Move probe(Board& board, std::mt19937& random) const;
+    size_t getEntryCount() const;
+
+    /**
+     * Writes a book made from games given one per line as moves in UCI notation from the starting position
+     * (`e2e4 e7e5 g1f3 ...`), going up to `plies` moves into each. Every move is weighted by how often it was played.
+     * Returns false if a game has a move that isn't legal, or the file couldn't be written.
+     */
+    static bool build(std::istream& games, const std::string& path, int plies, std::ostream& out);
+    static const int DefaultBuildPlies = 16;
+private:
+    static const size_t EntrySize = 16;
+    struct Entry {
+        uint64_t key;
+        uint16_t move;
+        uint16_t weight;
+    };
+
+    OpeningBook(const unsigned char* data, size_t size);
+    Entry getEntry(size_t index) const;
+    /**
+     * Polyglot packs moves as to file, to rank, from file, from rank (three bits each, lowest first),
+     * then the promotion piece (0 for none, then knight, bishop, rook, queen). Castling is the king taking its own rook,
+     * which is how our moves do it too.
+     */
+    static uint16_t encodeMove(const Move& move);
+    /**
+     * The Polyglot key of the position, which has nothing to do with our own Zobrist hash.
+     */
+    static uint64_t getKey(const Board& board);
+    static const uint64_t Random64[781];
+
+    const unsigned char* data;
+    size_t size;
+};
+
+#endif
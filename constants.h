@@ -2,7 +2,7 @@
 #define _CONSTANTS_H
 #include <cassert>
 #include <array>
-#include <map>
+#include <cstdint>
 
 // many modules require CentipawnScore
 typedef int CentipawnScore;
@@ -19,10 +19,17 @@ template <class T, size_t I, size_t J, size_t K> using TripleArray = std::array<
  */ 
 enum Constants {
     MaxDepth = 256,
-    MaxNumMoves = 236, //A (not too precise) upper bound on the number of pseudo-legal moves in a chess position. This allows us to allocate our vectors of a certain size right away, without having to do any reallocs.
+    MaxNumMoves = 256, //A (not too precise) upper bound on the number of pseudo-legal moves in a chess position. This is the capacity of a MoveList, so move generation never has to allocate.
     NumSquares = 64, NumColors = 2,
     NumRanks = 8, NumFiles = 8,
-    NumPieces = 6 //in the future, probably add NumPhases (for middle/endgame) and NumContinuations (for search)?
+    NumPieces = 6, //in the future, probably add NumContinuations (for search)?
+    NumPhases = 2
+};
+/**
+ * The two phases of the game that evaluation interpolates between, based on how much material is left.
+ */
+enum Phase {
+    Middlegame = 0, Endgame
 };
 /**
   * The two colors of pieces
@@ -120,13 +127,37 @@ enum GameState {
 };
 
 /**
- * Stores PSQT for static evaluation.
+ * A middlegame and an endgame score packed into one integer (the endgame one in the upper 16 bits),
+ * so that both can be kept up to date with a single add.
+ * Each half must stay within a 16 bit signed integer.
+ */
+typedef int32_t PackedScore;
+constexpr PackedScore makeScore(CentipawnScore middlegame, CentipawnScore endgame) {
+    return static_cast<PackedScore>(static_cast<uint32_t>(endgame) << 16) + middlegame;
+}
+constexpr CentipawnScore getMiddlegameScore(PackedScore score) {
+    return static_cast<int16_t>(static_cast<uint16_t>(static_cast<uint32_t>(score)));
+}
+constexpr CentipawnScore getEndgameScore(PackedScore score) {
+    //the rounding makes up for a negative middlegame score borrowing from the upper half
+    return static_cast<int16_t>(static_cast<uint16_t>((static_cast<uint32_t>(score) + 0x8000) >> 16));
+}
+static_assert(getMiddlegameScore(makeScore(-5, 7)) == -5 && getEndgameScore(makeScore(-5, 7)) == 7, "packed scores should unpack to what went in");
+
+/**
+ * How much each piece counts towards the game phase: MaxGamePhase with all the pieces on the board,
+ * down to 0 with just kings and pawns.
+ */
+constexpr int MaxGamePhase = 24;
+constexpr std::array<int, NumPieces> PiecePhases = {0, 1, 1, 2, 4, 0};
+
+/**
+ * Stores the middlegame PSQT for static evaluation, from White's side of the board (a1 first), indexed by Piece.
  * Based off Sunfish's PSQT: https://github.com/thomasahle/sunfish/blob/master/sunfish.py
  */
-static const std::map<ColorPiece, std::array<CentipawnScore, NumSquares>> psqt = {
-{
-	WhitePawn,
-    {	100,100,100,100,100,100,100,100,
+constexpr MultiArray<CentipawnScore, NumPieces, NumSquares> WhiteMiddlegamePsqt = {{
+    //Pawn
+    {{	100,100,100,100,100,100,100,100,
         69,108,93,63,64,86,103,69,
         78,109,105,89,90,98,103,81,
         74,103,110,109,106,101,100,77,
@@ -134,23 +165,9 @@ static const std::map<ColorPiece, std::array<CentipawnScore, NumSquares>> psqt =
         107,129,121,144,140,131,144,107,
         178,183,186,173,202,182,185,190,
         100,100,100,100,100,100,100,100,
-    }
-},
-{
-	BlackPawn,
-    {	-100,-100,-100,-100,-100,-100,-100,-100,
-        -178,-183,-186,-173,-202,-182,-185,-190,
-        -107,-129,-121,-144,-140,-131,-144,-107,
-        -83,-116,-98,-115,-114,-100,-115,-87,
-        -74,-103,-110,-109,-106,-101,-100,-77,
-        -78,-109,-105,-89,-90,-98,-103,-81,
-        -69,-108,-93,-63,-64,-86,-103,-69,
-        -100,-100,-100,-100,-100,-100,-100,-100,
-    }
-},
-{
-	WhiteKnight,
-    {	206,257,254,256,261,245,258,211,
+    }},
+    //Knight
+    {{	206,257,254,256,261,245,258,211,
         257,265,282,280,282,280,257,260,
         262,290,293,302,298,295,291,266,
         279,285,311,301,302,315,282,280,
@@ -158,23 +175,9 @@ static const std::map<ColorPiece, std::array<CentipawnScore, NumSquares>> psqt =
         290,347,281,354,353,307,342,278,
         277,274,380,244,284,342,276,266,
         214,227,205,205,270,225,222,210,
-    }
-},
-{
-	BlackKnight,
-    {	-214,-227,-205,-205,-270,-225,-222,-210,
-        -277,-274,-380,-244,-284,-342,-276,-266,
-        -290,-347,-281,-354,-353,-307,-342,-278,
-        -304,-304,-325,-317,-313,-321,-305,-297,
-        -279,-285,-311,-301,-302,-315,-282,-280,
-        -262,-290,-293,-302,-298,-295,-291,-266,
-        -257,-265,-282,-280,-282,-280,-257,-260,
-        -206,-257,-254,-256,-261,-245,-258,-211,
-    }
-},
-{
-	WhiteBishop,
-    {	313,322,305,308,306,305,310,310,
+    }},
+    //Bishop
+    {{	313,322,305,308,306,305,310,310,
         339,340,331,326,327,326,340,336,
         334,345,344,335,328,345,340,335,
         333,330,337,343,337,336,320,327,
@@ -182,23 +185,9 @@ static const std::map<ColorPiece, std::array<CentipawnScore, NumSquares>> psqt =
         311,359,288,361,372,310,348,306,
         309,340,355,278,281,351,322,298,
         261,242,238,244,297,213,283,270,
-    }
-},
-{
-	BlackBishop,
-    {	-261,-242,-238,-244,-297,-213,-283,-270,
-        -309,-340,-355,-278,-281,-351,-322,-298,
-        -311,-359,-288,-361,-372,-310,-348,-306,
-        -345,-337,-340,-354,-346,-345,-335,-330,
-        -333,-330,-337,-343,-337,-336,-320,-327,
-        -334,-345,-344,-335,-328,-345,-340,-335,
-        -339,-340,-331,-326,-327,-326,-340,-336,
-        -313,-322,-305,-308,-306,-305,-310,-310,
-    }
-},
-{
-	WhiteRook,
-    {	449,455,461,484,477,461,448,447,
+    }},
+    //Rook
+    {{	449,455,461,484,477,461,448,447,
         426,441,448,453,450,436,435,426,
         437,451,437,454,454,444,453,433,
         451,444,463,458,466,450,433,449,
@@ -206,23 +195,9 @@ static const std::map<ColorPiece, std::array<CentipawnScore, NumSquares>> psqt =
         498,514,507,512,524,506,504,494,
         534,508,535,546,534,541,513,539,
         514,508,512,483,516,512,535,529,
-    },
-},
-{
-	BlackRook,
-    {	-514,-508,-512,-483,-516,-512,-535,-529,
-        -534,-508,-535,-546,-534,-541,-513,-539,
-        -498,-514,-507,-512,-524,-506,-504,-494,
-        -479,-484,-495,-492,-497,-475,-470,-473,
-        -451,-444,-463,-458,-466,-450,-433,-449,
-        -437,-451,-437,-454,-454,-444,-453,-433,
-        -426,-441,-448,-453,-450,-436,-435,-426,
-        -449,-455,-461,-484,-477,-461,-448,-447,
-    }
-},
-{
-	WhiteQueen,
-    {	890,899,898,916,898,893,895,887,
+    }},
+    //Queen
+    {{	890,899,898,916,898,893,895,887,
         893,911,929,910,914,914,908,891,
         899,923,916,918,913,918,913,902,
         915,914,927,924,928,919,909,907,
@@ -230,23 +205,9 @@ static const std::map<ColorPiece, std::array<CentipawnScore, NumSquares>> psqt =
         927,972,961,989,1001,992,972,931,
         943,961,989,919,949,1005,986,953,
         935,930,921,825,998,953,1017,955,
-    }
-},
-{
-	BlackQueen,
-    {	-935,-930,-921,-825,-998,-953,-1017,-955,
-        -943,-961,-989,-919,-949,-1005,-986,-953,
-        -927,-972,-961,-989,-1001,-992,-972,-931,
-        -930,-913,-951,-946,-954,-949,-916,-923,
-        -915,-914,-927,-924,-928,-919,-909,-907,
-        -899,-923,-916,-918,-913,-918,-913,-902,
-        -893,-911,-929,-910,-914,-914,-908,-891,
-        -890,-899,-898,-916,-898,-893,-895,-887,
-    }
-},
-{
-	WhiteKing,
-    {	6017,6030,5997,5986,6006,5999,6040,6018,
+    }},
+    //King
+    {{	6017,6030,5997,5986,6006,5999,6040,6018,
         5996,6003,5986,5950,5943,5982,6013,6004,
         5953,5958,5957,5921,5936,5968,5971,5968,
         5945,5957,5948,5972,5949,5953,5992,5950,
@@ -254,34 +215,104 @@ static const std::map<ColorPiece, std::array<CentipawnScore, NumSquares>> psqt =
         5938,6012,5943,6044,5933,6028,6037,5969,
         5968,6010,6055,6056,6056,6055,6010,6003,
         6004,6054,6047,5901,5901,6060,6083,5938,
+    }},
+}};
+
+/**
+ * The endgame PSQT, laid out the same way. Pawns are worth more the further they've gone,
+ * the other pieces (kings especially) want to be in the center.
+ */
+constexpr MultiArray<CentipawnScore, NumPieces, NumSquares> WhiteEndgamePsqt = {{
+    //Pawn
+    {{	100,100,100,100,100,100,100,100,
+        110,110,110,110,110,110,110,110,
+        115,115,115,115,115,115,115,115,
+        125,125,125,125,125,125,125,125,
+        145,145,145,145,145,145,145,145,
+        180,180,180,180,180,180,180,180,
+        230,230,230,230,230,230,230,230,
+        100,100,100,100,100,100,100,100,
+    }},
+    //Knight
+    {{	275,275,275,275,275,275,275,275,
+        275,295,295,295,295,295,295,275,
+        275,295,310,310,310,310,295,275,
+        275,295,310,320,320,310,295,275,
+        275,295,310,320,320,310,295,275,
+        275,295,310,310,310,310,295,275,
+        275,295,295,295,295,295,295,275,
+        275,275,275,275,275,275,275,275,
+    }},
+    //Bishop
+    {{	310,310,310,310,310,310,310,310,
+        310,320,320,320,320,320,320,310,
+        310,320,326,326,326,326,320,310,
+        310,320,326,332,332,326,320,310,
+        310,320,326,332,332,326,320,310,
+        310,320,326,326,326,326,320,310,
+        310,320,320,320,320,320,320,310,
+        310,310,310,310,310,310,310,310,
+    }},
+    //Rook
+    {{	525,525,525,525,525,525,525,525,
+        525,525,525,525,525,525,525,525,
+        525,525,525,525,525,525,525,525,
+        525,525,525,525,525,525,525,525,
+        525,525,525,525,525,525,525,525,
+        525,525,525,525,525,525,525,525,
+        535,535,535,535,535,535,535,535,
+        525,525,525,525,525,525,525,525,
+    }},
+    //Queen
+    {{	913,913,913,913,913,913,913,913,
+        913,925,925,925,925,925,925,913,
+        913,925,933,933,933,933,925,913,
+        913,925,933,940,940,933,925,913,
+        913,925,933,940,940,933,925,913,
+        913,925,933,933,933,933,925,913,
+        913,925,925,925,925,925,925,913,
+        913,913,913,913,913,913,913,913,
+    }},
+    //King
+    {{	5975,5975,5975,5975,5975,5975,5975,5975,
+        5975,6005,6005,6005,6005,6005,6005,5975,
+        5975,6005,6025,6025,6025,6025,6005,5975,
+        5975,6005,6025,6040,6040,6025,6005,5975,
+        5975,6005,6025,6040,6040,6025,6005,5975,
+        5975,6005,6025,6025,6025,6025,6005,5975,
+        5975,6005,6005,6005,6005,6005,6005,5975,
+        5975,5975,5975,5975,5975,5975,5975,5975,
+    }},
+}};
+
+/**
+ * The packed PSQT for every ColorPiece (Empty and the unused numbers in between are all zeros), so the board
+ * can keep its running total with a plain array index per piece moved.
+ * Black's scores are White's mirrored vertically and negated, since the total is from White's point of view.
+ */
+constexpr MultiArray<PackedScore, Empty + 1, NumSquares> makePsqt() {
+    MultiArray<PackedScore, Empty + 1, NumSquares> table{};
+    for(int piece = Pawn; piece <= King; piece++) {
+        for(int square = 0; square < NumSquares; square++) {
+            table[piece * 4 + White][square] = makeScore(WhiteMiddlegamePsqt[piece][square], WhiteEndgamePsqt[piece][square]);
+            table[piece * 4 + Black][square ^ 56] = -makeScore(WhiteMiddlegamePsqt[piece][square], WhiteEndgamePsqt[piece][square]);
+        }
     }
-},
-{
-	BlackKing,
-    {	-6004,-6054,-6047,-5901,-5901,-6060,-6083,-5938,
-        -5968,-6010,-6055,-6056,-6056,-6055,-6010,-6003,
-        -5938,-6012,-5943,-6044,-5933,-6028,-6037,-5969,
-        -5945,-6050,-6011,-5996,-5981,-6013,-6000,-5951,
-        -5945,-5957,-5948,-5972,-5949,-5953,-5992,-5950,
-        -5953,-5958,-5957,-5921,-5936,-5968,-5971,-5968,
-        -5996,-6003,-5986,-5950,-5943,-5982,-6013,-6004,
-        -6017,-6030,-5997,-5986,-6006,-5999,-6040,-6018,
-    }
-},
-{
-    Empty,
-    {   0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 
-        0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0,
-    }
+    return table;
 }
-};
-
+inline constexpr MultiArray<PackedScore, Empty + 1, NumSquares> psqt = makePsqt();
 
+/**
+ * PiecePhases for every ColorPiece (and 0 for Empty), so it can be indexed like the PSQT.
+ */
+constexpr std::array<int, Empty + 1> makeColorPiecePhases() {
+    std::array<int, Empty + 1> phases{};
+    for(int piece = Pawn; piece <= King; piece++) {
+        phases[piece * 4 + White] = PiecePhases[piece];
+        phases[piece * 4 + Black] = PiecePhases[piece];
+    }
+    return phases;
+}
+inline constexpr std::array<int, Empty + 1> ColorPiecePhases = makeColorPiecePhases();
 
 #endif
\ No newline at end of file
@@ -2,12 +2,35 @@
 #define _DIFFICULTY_LEVEL_H
 
 #include "board.h"
+#include "book.h"
 #include "move.h"
 #include "moveorder.h"
 #include "evaluator.h"
+#include <array>
+#include <atomic>
 #include <memory>
+#include <random>
 #include <vector>
 
+/**
+ * Constraints on how long a difficulty level may think about its move.
+ * Anything left at zero is unlimited, and the search stops at whichever limit it hits first.
+ * Times are in milliseconds.
+ */
+struct SearchLimits {
+    int depth = 0;
+    long nodes = 0;
+    //exactly how long to spend on this move
+    int moveTime = 0;
+    //the clock of each side, for when we have to budget our own time
+    std::array<int, NumColors> time{};
+    std::array<int, NumColors> increment{};
+    //how many moves are left until the next time control (zero means sudden death)
+    int movesToGo = 0;
+    //if given, setting this from another thread ends the search early
+    const std::atomic<bool>* stop = nullptr;
+};
+
 /**
  * A class representing the difficulty level of an AI opponent.
  * Generally speaking, the opponent has 3 components that contribute its strength:
@@ -22,7 +45,20 @@ public:
     DifficultyLevel(const Evaluator& evaluator, const MoveOrderer& moveOrderer) : evaluator{evaluator.clone()} {
         moveOrderers.emplace_back(moveOrderer.clone());
     }
-    virtual Move getMove(Board& board) = 0; 
+    virtual Move getMove(Board& board, const SearchLimits& limits) = 0; 
+    /**
+     * Swaps out the evaluator (a copy of the one given is kept). Not to be called mid search.
+     */
+    virtual void setEvaluator(const Evaluator& evaluator) {
+        this->evaluator = evaluator.clone();
+    }
+    /**
+     * Plays straight from this book while it knows the position (nullptr for none).
+     * The book is shared, not copied, so every game and thread can use the same one.
+     */
+    void setOpeningBook(std::shared_ptr<const OpeningBook> book) {
+        openingBook = book;
+    }
     virtual ~DifficultyLevel() = default;
 protected:
     /**
@@ -34,6 +70,14 @@ protected:
      * Usually indexed by depth. 
      */
     std::vector<std::unique_ptr<MoveOrderer> > moveOrderers;
+    /**
+     * The book move for the position, or a null move if there's no book or it doesn't know the position.
+     */
+    Move getBookMove(Board& board) {
+        return openingBook ? openingBook->probe(board, bookRandom) : Move{};
+    }
+    std::shared_ptr<const OpeningBook> openingBook;
+    std::mt19937 bookRandom{std::random_device{}()};
 };
 
 #endif
\ No newline at end of file
@@ -4,7 +4,7 @@ LevelOne::LevelOne() : DifficultyLevel{TrivialEvaluator{}, RandomMoveOrderer{}}
 
 LevelTwo::LevelTwo() : DifficultyLevel{TrivialEvaluator{}, RandomMoveOrderer{}} {}
 
-Move LevelOne::getMove(Board& board) {
+Move LevelOne::getMove(Board& board, const SearchLimits& limits) {
     //Pick a random move:
     moveOrderers[0]->seedMoveOrderer(board, false);
     Move move = moveOrderers[0]->pickNextMove(false);
@@ -19,7 +19,7 @@ Move LevelOne::getMove(Board& board) {
     return Move{};
 }
 
-Move LevelTwo::getMove(Board& board) {
+Move LevelTwo::getMove(Board& board, const SearchLimits& limits) {
     //Pick a random move that preferably is a check or a noisy capture:
     moveOrderers[0]->seedMoveOrderer(board, true);
     Move move = moveOrderers[0]->pickNextMove(true);
@@ -6,13 +6,13 @@
 class LevelOne : public DifficultyLevel {
 public:    
     LevelOne();
-    Move getMove(Board& board) override;
+    Move getMove(Board& board, const SearchLimits& limits) override;
 };
 
 class LevelTwo : public DifficultyLevel {
 public:    
     LevelTwo();
-    Move getMove(Board& board) override;
+    Move getMove(Board& board, const SearchLimits& limits) override;
 };
 
 #endif
\ No newline at end of file
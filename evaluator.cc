@@ -1,4 +1,5 @@
 #include <numeric>
+#include <algorithm>
 #include "evaluator.h"
 
 /**
@@ -79,20 +80,50 @@ CentipawnScore EvalLevelFour::staticEvaluate(const Board& board) {
     }
     // Give bonuses to positionally good things (like rooks on open files)
     // and penalize bad things (like isolated pawns).
-    CentipawnScore isolatedPawns = IsolatedPawnBonus * (board.getNumberOfIsolatedPawns(White) - board.getNumberOfIsolatedPawns(Black));
-    CentipawnScore passedPawns = PassedPawnBouns * (board.getNumberOfPassedPawns(White) - board.getNumberOfPassedPawns(Black));
-    CentipawnScore bishopPair = 0;
+    PackedScore pawnStructure = evaluatePawns(board).score;
+    PackedScore bishopPair = 0;
     if(board.getSidePieceCount(White, Bishop) >= 2) {
         bishopPair += BishopPairBonus;
     }
     if(board.getSidePieceCount(Black, Bishop) >= 2) {
         bishopPair -= BishopPairBonus;
     }
-    CentipawnScore rookBonus = RookOpenFileBonus * (board.getNumberOfPiecesOnOpenFile(White, Rook) - board.getNumberOfPiecesOnOpenFile(Black, Rook));
-    rookBonus += RookSemiOpenFileBonus * (board.getNumberOfPiecesOnSemiOpenFile(White, Rook) - board.getNumberOfPiecesOnSemiOpenFile(Black, Rook));
-    CentipawnScore queenBonus = QueenOpenFileBonus * (board.getNumberOfPiecesOnOpenFile(White, Queen) - board.getNumberOfPiecesOnOpenFile(Black, Queen));
-    queenBonus += QueenSemiOpenFileBonus * (board.getNumberOfPiecesOnSemiOpenFile(White, Queen) - board.getNumberOfPiecesOnSemiOpenFile(Black, Queen));
+    //the file masks are worked out once, then it's just a popcount per piece type
+    Bitboard openFiles = board.getOpenFiles();
+    PackedScore fileBonus = 0;
+    for(Color side : {White, Black}) {
+        Bitboard semiOpenFiles = board.getSemiOpenFiles(side);
+        Bitboard rooks = board.getPieces(side, Rook);
+        Bitboard queens = board.getPieces(side, Queen);
+        PackedScore sideBonus = RookOpenFileBonus * __builtin_popcountll(rooks & openFiles) + RookSemiOpenFileBonus * __builtin_popcountll(rooks & semiOpenFiles);
+        sideBonus += QueenOpenFileBonus * __builtin_popcountll(queens & openFiles) + QueenSemiOpenFileBonus * __builtin_popcountll(queens & semiOpenFiles);
+        fileBonus += side == White ? sideBonus : -sideBonus;
+    }
+
+    PackedScore subtotal = TempoBonus * (board.getTurn() == White ? 1 : -1) + board.getCurrentPsqt() + pawnStructure + bishopPair + fileBonus;
+
+    //blend the middlegame and endgame scores by how much material is left
+    int phase = std::min(board.getGamePhase(), MaxGamePhase);
+    CentipawnScore eval = (getMiddlegameScore(subtotal) * phase + getEndgameScore(subtotal) * (MaxGamePhase - phase)) / MaxGamePhase;
+    return board.getTurn() == White ? eval : -eval;
+}
 
-    CentipawnScore subtotal = board.getCurrentPsqt() + isolatedPawns + bishopPair + passedPawns + rookBonus + queenBonus;
-    return TempoBonus + (board.getTurn() == White ? subtotal : -subtotal);
+const PawnHashTable::Entry& EvalLevelFour::evaluatePawns(const Board& board) {
+    PawnHashTable::Entry& entry = pawnTable.getEntry(board.getPawnHash());
+    if(entry.pawnHash == board.getPawnHash()) {
+        return entry;
+    }
+    entry.pawnHash = board.getPawnHash();
+    entry.passedPawns[White] = board.getPassedPawns(White);
+    entry.passedPawns[Black] = board.getPassedPawns(Black);
+    entry.score = IsolatedPawnBonus * (board.getNumberOfIsolatedPawns(White) - board.getNumberOfIsolatedPawns(Black));
+    entry.score += PassedPawnBouns * (__builtin_popcountll(entry.passedPawns[White]) - __builtin_popcountll(entry.passedPawns[Black]));
+    return entry;
+}
+
+CentipawnScore EvalLevelNNUE::staticEvaluate(const Board& board) {
+    if(board.isBoardMaterialDraw()) {
+        return 0;
+    }
+    return Network::getNetwork().evaluate(board.getAccumulator(), board.getTurn());
 }
@@ -4,6 +4,7 @@
 #include "board.h"
 #include "constants.h"
 #include <memory>
+#include <vector>
 
 typedef int CentipawnScore;
 
@@ -32,6 +33,31 @@ public:
     }
 };
 
+/**
+ * Remembers the evaluation of pawn structures, keyed by the board's pawn hash.
+ * Pawns move much less often than everything else, so nearly every lookup is a hit.
+ * It isn't shared: each evaluator (and so each search thread) has its own.
+ */
+class PawnHashTable {
+public:
+    struct Entry {
+        uint64_t pawnHash = 0;
+        PackedScore score = 0;
+        std::array<Bitboard, NumColors> passedPawns{};
+    };
+    PawnHashTable() : entries(NumEntries) {}
+    /**
+     * The slot the structure goes in; it is a hit if the entry's pawnHash matches.
+     * (A fresh entry is exactly right for a board with no pawns, whose hash is 0.)
+     */
+    Entry& getEntry(uint64_t pawnHash) {
+        return entries[pawnHash & (NumEntries - 1)];
+    }
+private:
+    static const int NumEntries = 1 << 14;
+    std::vector<Entry> entries;
+};
+
 class EvalLevelFour : public Evaluator {
 public:
     CentipawnScore staticEvaluate(const Board& board) override;
@@ -39,16 +65,34 @@ public:
         return std::make_unique<EvalLevelFour>(*this);
     }
 private:
-    //Some weights of how good things are in the evaluation, these could
+    /**
+     * The isolated and passed pawn terms, which only depend on where the pawns are.
+     */
+    const PawnHashTable::Entry& evaluatePawns(const Board& board);
+    PawnHashTable pawnTable;
+
+    //Some weights of how good things are in the evaluation (middlegame, endgame), these could
     //be implemented as setting without too much effort if we wanted that
-    static const CentipawnScore TempoBonus = 20;
-    static const CentipawnScore RookOpenFileBonus = 6;
-    static const CentipawnScore RookSemiOpenFileBonus = 6;
-    static const CentipawnScore QueenOpenFileBonus = 2;
-    static const CentipawnScore QueenSemiOpenFileBonus = 3;
-    static const CentipawnScore BishopPairBonus = 30;
-    static const CentipawnScore IsolatedPawnBonus = -10;
-    static const CentipawnScore PassedPawnBouns = 80;
+    static constexpr PackedScore TempoBonus = makeScore(20, 10);
+    static constexpr PackedScore RookOpenFileBonus = makeScore(8, 4);
+    static constexpr PackedScore RookSemiOpenFileBonus = makeScore(6, 4);
+    static constexpr PackedScore QueenOpenFileBonus = makeScore(2, 2);
+    static constexpr PackedScore QueenSemiOpenFileBonus = makeScore(3, 3);
+    static constexpr PackedScore BishopPairBonus = makeScore(25, 45);
+    static constexpr PackedScore IsolatedPawnBonus = makeScore(-10, -15);
+    static constexpr PackedScore PassedPawnBouns = makeScore(50, 110);
+};
+
+/**
+ * Evaluates with the NNUE network (see nnue.h), which has to have been loaded first.
+ * The board keeps the network's accumulator up to date as moves are made, so this is just the output layer.
+ */
+class EvalLevelNNUE : public Evaluator {
+public:
+    CentipawnScore staticEvaluate(const Board& board) override;
+    std::unique_ptr<Evaluator> clone() const override {
+        return std::make_unique<EvalLevelNNUE>(*this);
+    }
 };
 
 #endif
@@ -2,8 +2,9 @@
 #include <algorithm>
 #include <cmath>
 #include "moveorder.h"
+#include <thread>
 
-FullStrength::FullStrength(int depthLevel) : DifficultyLevel{EvalLevelFour{}, HeuristicMoveOrderer{}}, depthLevel{depthLevel}, pastScores{} {
+FullStrength::FullStrength(int depthLevel, int hashSizeMegabytes) : DifficultyLevel{EvalLevelFour{}, HeuristicMoveOrderer{}}, depthLevel{depthLevel}, transpositionTable{hashSizeMegabytes} {
     lmrTable[0] = {0};
     for(int depth = 1; depth < LateMoveReductionDepth; ++depth) {
         lmrTable[depth][0] = 0;
@@ -14,45 +15,290 @@ FullStrength::FullStrength(int depthLevel) : DifficultyLevel{EvalLevelFour{}, He
     }
     lmpTable[0][0] = 0;
     lmpTable[1][0] = 0;
-    for(int depth = 1; depth < LateMovePruningDepth; ++depth) {
+    for(int depth = 1; depth <= LateMovePruningDepth; ++depth) {
         lmpTable[0][depth] = (int)(2.5 + 2 * depth * depth / 4.5);
         lmpTable[1][depth] = (int)(4 + 4 * depth * depth / 4.5);
     }
 }
 
-Move FullStrength::getMove(Board& board) {
+void FullStrength::setThreadCount(int threadCount) {
+    this->threadCount = std::max(1, threadCount);
+}
+
+void FullStrength::setHashSize(int sizeMegabytes) {
+    transpositionTable.resize(sizeMegabytes);
+}
+
+void FullStrength::newGame() {
+    transpositionTable.clear();
+    //the threads (and their histories) get made again on the next search
+    threads.clear();
+}
+
+void FullStrength::setEvaluator(const Evaluator& evaluator) {
+    DifficultyLevel::setEvaluator(evaluator);
+    //each thread has its own copy of the evaluator, so they need making again
+    threads.clear();
+}
+
+void FullStrength::setInfoHandler(std::function<void(const SearchInfo&)> handler) {
+    infoHandler = handler;
+}
+
+void FullStrength::setStatisticsHandler(std::function<void(const SearchStatistics&)> handler) {
+    statisticsHandler = handler;
+}
+
+MoveOrderer& FullStrength::SearchThread::getMoveOrderer(int searchPly) {
+    while(moveOrderers.size() <= (size_t)searchPly) {
+        moveOrderers.emplace_back(std::make_unique<HeuristicMoveOrderer>(history));
+    }
+    return *moveOrderers[searchPly];
+}
+
+Move FullStrength::getMove(Board& board, const SearchLimits& limits) {
+    Move bookMove = getBookMove(board);
+    if(!bookMove.isMoveNone()) {
+        return bookMove;
+    }
+    //the per thread state (most importantly the move histories) is kept between moves unless the thread count changes
+    if(threads.size() != (size_t)threadCount) {
+        threads.clear();
+        for(int id = 0; id < threadCount; id++) {
+            threads.emplace_back(std::make_unique<SearchThread>());
+            threads.back()->id = id;
+            threads.back()->evaluator = evaluator->clone();
+            threads.back()->history = std::make_shared<MoveHistory>();
+        }
+    }
+    for(std::unique_ptr<SearchThread>& thread : threads) {
+        thread->nodeCount.store(0, std::memory_order_relaxed);
+        thread->statistics.clear();
+    }
+    statistics.clear();
     startingMove = board.getTotalPlies();
+    transpositionTable.newSearch();
+    initTimeManagement(board, limits);
+    int maxDepth = limits.depth > 0 ? std::min(limits.depth, depthLevel) : depthLevel;
+
+    std::vector<std::thread> helpers;
+    for(size_t i = 1; i < threads.size(); i++) {
+        SearchThread& thread = *threads[i];
+        thread.board = std::make_unique<Board>(board.cloneForSearch());
+        helpers.emplace_back([this, &thread, maxDepth]() {
+            iterativeDeepening(thread, *thread.board, maxDepth);
+        });
+    }
+    SearchThread& mainThread = *threads[SearchThread::MainThread];
+    iterativeDeepening(mainThread, board, maxDepth);
+    //the main thread is done, so whatever the helpers were working on is no longer needed
+    stopSearch = true;
+    for(std::thread& helper : helpers) {
+        helper.join();
+    }
+    Move bestMove = mainThread.principalVariation.moves[0];
+    assert(mainThread.principalVariation.length > 0 && !bestMove.isMoveNone());
+    if(statisticsHandler) {
+        statistics.recordSearch(getElapsedMilliseconds(), getStatisticsCounts());
+        statisticsHandler(statistics);
+    }
+    return bestMove;
+}
+
+void FullStrength::iterativeDeepening(SearchThread& thread, Board& board, int maxDepth) {
+    thread.principalVariation.length = 0;
+
     //Our difficulty is determined by how far we look, i.e. depth level.
-    alphabeta(board, -Infinite, Infinite, depthLevel);
-    Move move = bestMoves[board.getBoardHash()];
-    assert(!move.isMoveNone());
-    return move;
+    //We get there by iterative deepening: searching depth 1, then 2, and so on. Each iteration fills the
+    //transposition table and principal variation that make the next one's move ordering much better,
+    //so this is usually faster than going straight to the full depth.
+    //Every other helper starts a depth ahead, so the threads aren't all working on the same iteration.
+    CentipawnScore score = 0;
+    for(int depth = 1 + (thread.id & 1); depth <= maxDepth; depth++) {
+        score = aspirationWindow(thread, board, depth, score);
+        //if we ran out of time partway through, this iteration's result can't be trusted
+        if(isStopped(thread)) {
+            break;
+        }
+        if(thread.id == SearchThread::MainThread) {
+            reportIteration(thread, depth, score);
+            if(statisticsHandler) {
+                statistics.recordIteration(depth, getElapsedMilliseconds(), getStatisticsCounts());
+            }
+        }
+        //there's probably not enough time left to finish another iteration
+        if(thread.id == SearchThread::MainThread && softTimeLimit != 0 && getElapsedMilliseconds() >= softTimeLimit) {
+            break;
+        }
+    }
+}
+
+void FullStrength::initTimeManagement(const Board& board, const SearchLimits& limits) {
+    startTime = std::chrono::steady_clock::now();
+    stopSearch = false;
+    nodeLimit = limits.nodes;
+    externalStop = limits.stop;
+    softTimeLimit = 0;
+    hardTimeLimit = 0;
+
+    if(limits.moveTime > 0) {
+        softTimeLimit = hardTimeLimit = std::max(1, limits.moveTime - MoveOverhead);
+    } else if(limits.time[board.getTurn()] > 0) {
+        //Budget an even share of our remaining time (plus most of what we get back),
+        //but let an iteration run a few times over that if it has to.
+        long available = std::max(1, limits.time[board.getTurn()] - MoveOverhead);
+        int movesToGo = limits.movesToGo > 0 ? limits.movesToGo : DefaultMovesToGo;
+        softTimeLimit = available / movesToGo + limits.increment[board.getTurn()] * 3 / 4;
+        hardTimeLimit = std::min(available, softTimeLimit * HardLimitScale);
+        softTimeLimit = std::max(1l, std::min(softTimeLimit, hardTimeLimit));
+    }
+}
+
+long FullStrength::getElapsedMilliseconds() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+long FullStrength::getNodeCount() const {
+    long total = 0;
+    for(const std::unique_ptr<SearchThread>& thread : threads) {
+        total += thread->nodeCount.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+SearchStatistics::Counts FullStrength::getStatisticsCounts() const {
+    SearchStatistics::Counts total{};
+    for(const std::unique_ptr<SearchThread>& thread : threads) {
+        thread->statistics.addTo(total);
+    }
+    return total;
+}
+
+bool FullStrength::isStopped(const SearchThread& thread) const {
+    //never stop the main thread before it's finished one iteration, or else we'd have no move to give back
+    if(thread.id == SearchThread::MainThread && thread.principalVariation.length == 0) {
+        return false;
+    }
+    return stopSearch.load(std::memory_order_relaxed);
+}
+
+bool FullStrength::shouldStop(SearchThread& thread) {
+    //only the main thread keeps track of the limits, the helpers just wait to be told
+    if(thread.id == SearchThread::MainThread && !stopSearch.load(std::memory_order_relaxed) && (thread.nodeCount.load(std::memory_order_relaxed) & TimeCheckInterval) == 0) {
+        if((nodeLimit != 0 && getNodeCount() >= nodeLimit) || (hardTimeLimit != 0 && getElapsedMilliseconds() >= hardTimeLimit)
+        || (externalStop != nullptr && externalStop->load(std::memory_order_relaxed))) {
+            stopSearch = true;
+        }
+    }
+    return isStopped(thread);
+}
+
+void FullStrength::reportIteration(const SearchThread& thread, int depth, CentipawnScore score) {
+    if(!infoHandler) {
+        return;
+    }
+    SearchInfo info;
+    info.depth = depth;
+    info.score = score;
+    info.mateIn = 0;
+    //mate scores count plies from the root, and an odd number of plies means we're the one giving mate
+    if(score >= Checkmate) {
+        info.mateIn = (Infinite - score + 1) / 2;
+    } else if(score <= -Checkmate) {
+        info.mateIn = -(Infinite + score) / 2;
+    }
+    info.nodes = getNodeCount();
+    info.milliseconds = getElapsedMilliseconds();
+    info.hashfull = transpositionTable.getHashfull();
+    info.principalVariation.assign(thread.principalVariation.moves.begin(), thread.principalVariation.moves.begin() + thread.principalVariation.length);
+    infoHandler(info);
 }
 
-CentipawnScore FullStrength::getDeltaPruningMargin(Board& board) {
-    CentipawnScore base = board.currentSideAboutToPromote() ? evaluator->getPieceValue(Queen) : evaluator->getPieceValue(Pawn);
+CentipawnScore FullStrength::aspirationWindow(SearchThread& thread, Board& board, int depth, CentipawnScore previousScore) {
+    //The score usually doesn't change much between iterations, so search with a narrow window around the last one,
+    //since a narrower window prunes much more. If the real score falls outside of it, widen it and try again.
+    CentipawnScore delta = AspirationWindow;
+    CentipawnScore alpha = -Infinite;
+    CentipawnScore beta = Infinite;
+    if(depth >= AspirationDepth) {
+        alpha = std::max(-Infinite, previousScore - delta);
+        beta = std::min(Infinite, previousScore + delta);
+    }
+    while(true) {
+        PrincipalVariation pv;
+        thread.isFollowingPv[0] = true;
+        CentipawnScore score = alphabeta(thread, board, alpha, beta, depth, pv);
 
-    CentipawnScore max = evaluator->getPieceValue(Pawn);
+        if(isStopped(thread)) {
+            return previousScore;
+        }
+        if(score > alpha && score < beta) {
+            thread.principalVariation = pv;
+            return score;
+        }
+        if(score <= alpha) {
+            //failed low, bring beta down too since the score is probably lower than we thought
+            beta = (alpha + beta) / 2;
+            alpha = std::max(-Infinite, alpha - delta);
+        } else {
+            beta = std::min(Infinite, beta + delta);
+        }
+        delta += delta / 2;
+    }
+}
+
+CentipawnScore FullStrength::scoreToTable(CentipawnScore score, int searchPly) {
+    if(score >= Checkmate) {
+        return score + searchPly;
+    } else if(score <= -Checkmate) {
+        return score - searchPly;
+    }
+    return score;
+}
+
+CentipawnScore FullStrength::scoreFromTable(CentipawnScore score, int searchPly) {
+    if(score >= Checkmate) {
+        return score - searchPly;
+    } else if(score <= -Checkmate) {
+        return score + searchPly;
+    }
+    return score;
+}
+
+CentipawnScore FullStrength::getDeltaPruningMargin(SearchThread& thread, Board& board) {
+    CentipawnScore base = board.currentSideAboutToPromote() ? thread.evaluator->getPieceValue(Queen) : thread.evaluator->getPieceValue(Pawn);
+
+    CentipawnScore max = thread.evaluator->getPieceValue(Pawn);
     for(int piece = Pawn; piece <= Queen; piece++) {
         if(board.currentSideHasPiece(static_cast<Piece>(piece))) {
-            max = std::max(max, evaluator->getPieceValue(static_cast<Piece>(piece)));
+            max = std::max(max, thread.evaluator->getPieceValue(static_cast<Piece>(piece)));
         }
     }
     return base + max;
 }
 
-CentipawnScore FullStrength::quiescence(Board& board, CentipawnScore alpha, CentipawnScore beta) {
+CentipawnScore FullStrength::quiescence(SearchThread& thread, Board& board, CentipawnScore alpha, CentipawnScore beta) {
     //Quiescence is a specialized alpha-beta search focused on tactical moves like captures.
-    nodeCount++;
-    if(board.isDrawn()) {
+    thread.countNode();
+    thread.statistics.count(SearchStatistics::QuiescenceNodes);
+    if(shouldStop(thread)) {
         return 0;
     }
     int searchPly = board.getTotalPlies() - startingMove;
+    if(board.isDrawn(searchPly)) {
+        return 0;
+    }
+    if(alpha < 0 && board.hasUpcomingRepetition(searchPly)) {
+        alpha = 0;
+        if(alpha >= beta) {
+            return alpha;
+        }
+    }
 
     if(searchPly >= MaxDepth) {
-        return evaluator->staticEvaluate(board);
+        return thread.evaluator->staticEvaluate(board);
     }
-    CentipawnScore score = evaluator->staticEvaluate(board);
+    CentipawnScore score = thread.evaluator->staticEvaluate(board);
 
     //if we beat beta, assume we have a beta cutoff
     if(score >= beta) {
@@ -61,29 +307,26 @@ CentipawnScore FullStrength::quiescence(Board& board, CentipawnScore alpha, Cent
 
     //Delta Pruning: if the best possible outcome of a move can't change our situation,
     //stop calculating
-    if(score + getDeltaPruningMargin(board) < alpha) {
+    if(score + getDeltaPruningMargin(thread, board) < alpha) {
         return alpha;
     }
     alpha = std::max(score, alpha);
 
-    MoveOrderer* moveOrderer;
-    if(moveOrderers.size() > (size_t)searchPly) {
-        moveOrderer = moveOrderers[searchPly].get();
-    } else {
-        moveOrderers.emplace_back(HeuristicMoveOrderer{}.clone());
-        moveOrderer = moveOrderers[searchPly].get();
-    }
+    MoveOrderer* moveOrderer = &thread.getMoveOrderer(searchPly);
 
     moveOrderer->seedMoveOrderer(board, true);
-    HeuristicMoveOrderer::setSeeMarginInOrdering(std::max(1, alpha - score - QuiesSeeMargin));
+    dynamic_cast<HeuristicMoveOrderer&>(*moveOrderer).setSeeMarginInOrdering(std::max(1, alpha - score - QuiesSeeMargin));
     
     Move move;
     while(!(move = moveOrderer->pickNextMove(true)).isMoveNone()) {
         if(!board.applyMove(move)) {
             continue;
         }
-        score = -quiescence(board, -beta, -alpha);
+        score = -quiescence(thread, board, -beta, -alpha);
         board.revertMostRecent();
+        if(isStopped(thread)) {
+            return 0;
+        }
 
         if(score > alpha) {
             alpha = score;
@@ -95,7 +338,8 @@ CentipawnScore FullStrength::quiescence(Board& board, CentipawnScore alpha, Cent
     return alpha;
 }
 
-CentipawnScore FullStrength::alphabeta(Board& board, CentipawnScore alpha, CentipawnScore beta, int depth) {
+CentipawnScore FullStrength::alphabeta(SearchThread& thread, Board& board, CentipawnScore alpha, CentipawnScore beta, int depth, PrincipalVariation& pv) {
+    pv.length = 0;
     //if we are in check, look a move farther to ensure we don't miscalculate something after getting out of check
     if(board.isCurrentTurnInCheck()) {
         depth++;
@@ -104,22 +348,33 @@ CentipawnScore FullStrength::alphabeta(Board& board, CentipawnScore alpha, Centi
     //if we are out of moves to look at, do a tactical search
     //to ensure we don't hang pieces
     if(depth <= 0 && !board.isCurrentTurnInCheck()) {
-        return quiescence(board, alpha, beta);
+        return quiescence(thread, board, alpha, beta);
     }
     int searchPly = board.getTotalPlies() - startingMove;
     bool isRootNode = searchPly == 0;
     bool isPrincipalVariation = alpha != beta - 1;
 
-    nodeCount++;
+    thread.countNode();
+    thread.statistics.count(SearchStatistics::Nodes);
+    if(shouldStop(thread)) {
+        return 0;
+    }
 
     //If the board is in a position where we can conclude early (like we have found a forced checkmate already)
     //then do that conclusion. We can't do it in the root node, or else we wouldn't return a bestmove.
     if(!isRootNode) {
-        if(board.isDrawn()) {
+        if(board.isDrawn(searchPly)) {
             return 0;
         }
+        //if we can go back to a position we've been in, we can force a draw, so we never have to settle for less
+        if(alpha < 0 && board.hasUpcomingRepetition(searchPly)) {
+            alpha = 0;
+            if(alpha >= beta) {
+                return alpha;
+            }
+        }
         if(searchPly >= MaxDepth) {
-            return board.isCurrentTurnInCheck() ? 0 : evaluator->staticEvaluate(board);
+            return board.isCurrentTurnInCheck() ? 0 : thread.evaluator->staticEvaluate(board);
         }
 
         //If we have found a forced checkmate, cut off what we search to only try to find a better checkmate
@@ -131,13 +386,32 @@ CentipawnScore FullStrength::alphabeta(Board& board, CentipawnScore alpha, Centi
     }
     //ensure depth is nonnegative
     depth = std::max(depth, 0);
+    CentipawnScore originalAlpha = alpha;
+
+    //Check if we've already searched this position. If we searched it at least as deeply
+    //and the score we got back settles this window, there's no need to search it again.
+    TranspositionTable::Entry hashEntry;
+    Move hashMove;
+    thread.statistics.count(SearchStatistics::HashProbes);
+    if(transpositionTable.probe(board.getBoardHash(), hashEntry)) {
+        thread.statistics.count(SearchStatistics::HashHits);
+        hashMove = hashEntry.move;
+        CentipawnScore hashScore = scoreFromTable(hashEntry.score, searchPly);
+        if(!isPrincipalVariation && hashEntry.depth >= depth
+        && (hashEntry.bound == TranspositionTable::Exact
+        || (hashEntry.bound == TranspositionTable::Lower && hashScore >= beta)
+        || (hashEntry.bound == TranspositionTable::Upper && hashScore <= alpha))) {
+            thread.statistics.count(SearchStatistics::HashCutoffs);
+            return hashScore;
+        }
+    }
 
     CentipawnScore score = -Infinite;
     CentipawnScore bestScore = -Infinite;
-    CentipawnScore staticEval = board.isCurrentTurnInCheck() ? NoScore : evaluator->staticEvaluate(board);
-    pastScores[searchPly] = staticEval;
+    CentipawnScore staticEval = board.isCurrentTurnInCheck() ? NoScore : thread.evaluator->staticEvaluate(board);
+    thread.pastScores[searchPly] = staticEval;
 
-    bool hasPositionImproved = !board.isCurrentTurnInCheck() && searchPly >= 2 && staticEval > pastScores[searchPly - 2];
+    bool hasPositionImproved = !board.isCurrentTurnInCheck() && searchPly >= 2 && staticEval > thread.pastScores[searchPly - 2];
     
     //We're about to do some old school alpha beta search.
     //Alpha represents the lower bound of score a move must have to not be ruled out,
@@ -149,31 +423,33 @@ CentipawnScore FullStrength::alphabeta(Board& board, CentipawnScore alpha, Centi
     //razoring - if our current static evaluation is significantly lower than alpha,
     //our position sucks and so just ensure we don't miss any tactics then return
     if(!isRootNode && !board.isCurrentTurnInCheck() && !isPrincipalVariation && depth < 2 && staticEval + RazorMargin < alpha) {
-        return quiescence(board, alpha, beta);
+        thread.statistics.count(SearchStatistics::RazorPrunes);
+        return quiescence(thread, board, alpha, beta);
     }
 
     //reverse futility, if our position's evaluation is significantly higher than beta
     //then assume it will hold (i.e. our position is so good in every possible way, there's no way we can lose suddenly)
     if(!isRootNode && !board.isCurrentTurnInCheck() && !isPrincipalVariation && depth <= ReverseFutilityDepth && staticEval - ReverseFutilityMargin * depth > beta) {
+        thread.statistics.count(SearchStatistics::ReverseFutilityPrunes);
         return staticEval;
     }
 
-    std::vector<Move> quietsTried;
-    std::vector<Move> noisyTried;
+    MoveList quietsTried;
+    MoveList noisyTried;
 
-    MoveOrderer* moveOrderer;
-    if(moveOrderers.size() > (size_t)searchPly) {
-        moveOrderer = moveOrderers[searchPly].get();
-    } else {
-        moveOrderers.emplace_back(HeuristicMoveOrderer{}.clone());
-        moveOrderer = moveOrderers[searchPly].get();
-    }
+    MoveOrderer* moveOrderer = &thread.getMoveOrderer(searchPly);
 
     bool noisyOnly = false;
     moveOrderer->seedMoveOrderer(board, false);
+    //while we're still on the last iteration's principal variation, its move is the one to try first
+    if(thread.isFollowingPv[searchPly] && searchPly < thread.principalVariation.length) {
+        hashMove = thread.principalVariation.moves[searchPly];
+    }
+    dynamic_cast<HeuristicMoveOrderer&>(*moveOrderer).setHashMove(hashMove);
 
     Move move;
     Move bestMove;
+    PrincipalVariation childPv;
     int movesSeen = 0;
     int movesPlayed = 0;
     while(!(move = moveOrderer->pickNextMove(noisyOnly)).isMoveNone()) {
@@ -181,28 +457,35 @@ CentipawnScore FullStrength::alphabeta(Board& board, CentipawnScore alpha, Centi
 
         int improvedIndex = hasPositionImproved ? 1 : 0;
         //Late Move Pruning, if we have calculated many moves in this position already,
-        //and we aren't optimistic about this move, skip the quiets
+        //and we aren't optimistic about this move, skip the quiets (the orderer still gives back the ones that give check)
         if(bestScore > -Checkmate && depth <= LateMovePruningDepth && movesSeen >= lmpTable[improvedIndex][depth]) {
+            if(!noisyOnly) {
+                thread.statistics.count(SearchStatistics::LateMovePrunes);
+            }
             noisyOnly = true;
         }
         bool isMoveTactical = board.isMoveTactical(move);
 
-        HeuristicScore historyHeuristic = isMoveTactical ? HeuristicMoveOrderer::getNoisyHeuristic(board, move) : HeuristicMoveOrderer::getQuietHeuristic(board, move);
+        HeuristicScore historyHeuristic = isMoveTactical ? thread.history->getNoisyHeuristic(board, move) : thread.history->getQuietHeuristic(board, move);
         //Quiet Move Pruning. If we prove that a line where we don't lose by force exists in this quiet move,
         //then skip it if its not interesting enough
         if(!isMoveTactical && bestScore > -Checkmate) {
             int lmrDepth = std::max(0, depth - lmrTable[std::min(depth, 63)][std::min(depth, 63)]);
             int futilityMargin = FutilityMargin + lmrDepth * FutilityMarginAdded;
 
-            //futility pruning, if we aren't optimistic about the rest of our quiets then skip them
+            //futility pruning, if we aren't optimistic about the rest of our quiets then skip them (other than checks, as above)
             if(!board.isCurrentTurnInCheck() && staticEval + futilityMargin + FutilityMarginNoHistory <= alpha && lmrDepth <= FutilityDepth) {
+                if(!noisyOnly) {
+                    thread.statistics.count(SearchStatistics::FutilityPrunes);
+                }
                 noisyOnly = true;
             }
         }
 
         //Static Exchange Evaluation (see moveorder.h for in depth explanation)
         if(bestScore > -Checkmate && depth <= SeeDepth) {
-            if(!HeuristicMoveOrderer::staticExchangeEvaluation(board, move, isMoveTactical ? SeeNoisyMargin : SeeQuietMargin)) {
+            if(dynamic_cast<HeuristicMoveOrderer&>(*moveOrderer).getStaticExchangeEvaluation(move) < (isMoveTactical ? SeeNoisyMargin : SeeQuietMargin)) {
+                thread.statistics.count(SearchStatistics::SeePrunes);
                 continue;
             }
         }
@@ -210,6 +493,7 @@ CentipawnScore FullStrength::alphabeta(Board& board, CentipawnScore alpha, Centi
             continue;
         }
         movesPlayed++;
+        thread.isFollowingPv[searchPly + 1] = thread.isFollowingPv[searchPly] && searchPly < thread.principalVariation.length && move == thread.principalVariation.moves[searchPly];
         if(isMoveTactical) {
             noisyTried.emplace_back(move);
         } else {
@@ -243,22 +527,30 @@ CentipawnScore FullStrength::alphabeta(Board& board, CentipawnScore alpha, Centi
             
             //now do the reduced calculation
             //where we force it to be a principal line
-            score = -alphabeta(board, -alpha - 1, -alpha, depth - reduction);
+            score = -alphabeta(thread, board, -alpha - 1, -alpha, depth - reduction, childPv);
+            thread.statistics.count(SearchStatistics::ReducedSearches);
 
             //if we could not beat alpha, do a more minimal search in the future 
             //since it's highly likely we won't be able to beat it without reductions
             //(since heuristically, reduced moves are not likely to beat it)
             doFullSearch = score > alpha && reduction != 1;
+            if(doFullSearch) {
+                thread.statistics.count(SearchStatistics::ReSearches);
+            }
         }
 
         if(doFullSearch) {
-            score = -alphabeta(board, -alpha - 1, -alpha, depth - 1);
+            score = -alphabeta(thread, board, -alpha - 1, -alpha, depth - 1, childPv);
         }
         //search more fully for for principal variation moves
         if(isPrincipalVariation && (movesPlayed == 1 || score > alpha)) {
-            score = -alphabeta(board, -beta, -alpha, depth - 1);
+            score = -alphabeta(thread, board, -beta, -alpha, depth - 1, childPv);
         }
         board.revertMostRecent();
+        //whatever we got back from an abandoned search is meaningless, so don't let it touch anything
+        if(isStopped(thread)) {
+            return 0;
+        }
 
         if(score > bestScore) {
             bestScore = score;
@@ -266,12 +558,21 @@ CentipawnScore FullStrength::alphabeta(Board& board, CentipawnScore alpha, Centi
 
             if(score > alpha) {
                 alpha = score;
-                bestMoves[board.getBoardHash()] = bestMove;
+                //our principal variation is now this move followed by the best line after it
+                if(isPrincipalVariation) {
+                    pv.moves[0] = move;
+                    std::copy(childPv.moves.begin(), childPv.moves.begin() + childPv.length, pv.moves.begin() + 1);
+                    pv.length = childPv.length + 1;
+                }
 
                 //the search failed high, then we can stop looking
                 //since our lower bound is better than our upper bound
                 //i.e., even the worst move beats the best case scenario 
                 if(alpha >= beta) {
+                    thread.statistics.count(SearchStatistics::BetaCutoffs);
+                    if(movesPlayed == 1) {
+                        thread.statistics.count(SearchStatistics::FirstMoveCutoffs);
+                    }
                     break;
                 }
             }
@@ -280,9 +581,9 @@ CentipawnScore FullStrength::alphabeta(Board& board, CentipawnScore alpha, Centi
     //Seed our future heuristics based on the results of this search.
     if(bestScore >= beta) {
         if(!board.isMoveTactical(move)) {
-            HeuristicMoveOrderer::updateQuietHeuristics(board, quietsTried, depth);
+            thread.history->updateQuietHeuristics(board, quietsTried, depth);
         }
-        HeuristicMoveOrderer::updateNoisyHeuristics(board, noisyTried, bestMove, depth);
+        thread.history->updateNoisyHeuristics(board, noisyTried, bestMove, depth);
     }
     //there were no moves we were able to play, i.e. no legal moves
     if(movesPlayed == 0) {
@@ -294,5 +595,8 @@ CentipawnScore FullStrength::alphabeta(Board& board, CentipawnScore alpha, Centi
             return 0;
         }
     }
+    //Remember what we found for next time. If we never beat alpha, we don't actually know the best move.
+    TranspositionTable::Bound bound = bestScore >= beta ? TranspositionTable::Lower : (bestScore > originalAlpha ? TranspositionTable::Exact : TranspositionTable::Upper);
+    transpositionTable.store(board.getBoardHash(), bound == TranspositionTable::Upper ? Move{} : bestMove, scoreToTable(bestScore, searchPly), depth, bound);
     return bestScore;
 }
\ No newline at end of file
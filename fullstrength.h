@@ -2,23 +2,80 @@
 #define _FULL_STRENGTH_H
 #include "difficultylevel.h"
 #include "evaluator.h"
+#include "searchstatistics.h"
+#include "transposition.h"
 #include <array>
-#include <unordered_map>
+#include <atomic>
+#include <chrono>
+#include <functional>
 
 class FullStrength : public DifficultyLevel {
 public:
-    FullStrength(int depthLevel);
-    Move getMove(Board& board) override;
+    /**
+     * What the search has found so far, given out after every iteration it completes.
+     */
+    struct SearchInfo {
+        int depth;
+        CentipawnScore score;
+        //in moves, positive if we're the ones giving mate, or zero if the score isn't a mate
+        int mateIn;
+        long nodes;
+        long milliseconds;
+        //permille of the transposition table in use
+        int hashfull;
+        std::vector<Move> principalVariation;
+    };
+
+    FullStrength(int depthLevel, int hashSizeMegabytes = TranspositionTable::DefaultSizeMegabytes);
+    Move getMove(Board& board, const SearchLimits& limits) override;
+    /**
+     * How many threads search at once (Lazy SMP). Takes effect from the next search.
+     */
+    void setThreadCount(int threadCount);
+    /**
+     * Reallocates the transposition table, throwing away its contents. Not to be called mid search.
+     */
+    void setHashSize(int sizeMegabytes);
+    /**
+     * Forgets everything learned from previous searches. Not to be called mid search.
+     */
+    void newGame();
+    void setEvaluator(const Evaluator& evaluator) override;
+    void setInfoHandler(std::function<void(const SearchInfo&)> handler);
+    /**
+     * Called at the end of every search with what it got up to (which is all zeroes unless SearchStatistics::Enabled).
+     */
+    void setStatisticsHandler(std::function<void(const SearchStatistics&)> handler);
 private:
     int depthLevel;
-    long nodeCount = 0;
+    int threadCount = 1;
+    std::function<void(const SearchInfo&)> infoHandler;
+    std::function<void(const SearchStatistics&)> statisticsHandler;
+    SearchStatistics statistics;
     int startingMove = 0;
+
+    /**
+     * Time management. We don't start another iteration once we're past the soft limit,
+     * and abandon the current one once we're past the hard limit (or out of nodes).
+     * Limits are in milliseconds since the search started, zero meaning unlimited.
+     */
+    std::chrono::steady_clock::time_point startTime;
+    long softTimeLimit = 0;
+    long hardTimeLimit = 0;
+    long nodeLimit = 0;
+    const std::atomic<bool>* externalStop = nullptr;
+    /**
+     * Shared by every search thread, only the main thread decides when to set it.
+     */
+    std::atomic<bool> stopSearch{false};
+    void initTimeManagement(const Board& board, const SearchLimits& limits);
+    long getElapsedMilliseconds() const;
     /**
      * Some useful constants in our search
      */
-    static const CentipawnScore Infinite = 30000;
-    static const CentipawnScore NoScore = Infinite + 2;
-    static const CentipawnScore Checkmate = Infinite - MaxDepth;
+    static constexpr CentipawnScore Infinite = 30000;
+    static constexpr CentipawnScore NoScore = Infinite + 2;
+    static constexpr CentipawnScore Checkmate = Infinite - MaxDepth;
 
     //These are constants for various search heuristics.
     //They more or less are numbers that I've had in the past when coding this
@@ -44,15 +101,81 @@ private:
 
     static const int QuiesSeeMargin = 100;
 
-    std::array<CentipawnScore, MaxDepth> pastScores;
-    std::array<Move, MaxDepth> principalVariation;
+    //Iterative deepening searches this deep and beyond with a narrow window around the last iteration's score
+    static const int AspirationDepth = 5;
+    static const int AspirationWindow = 16;
+
+    //How often (in nodes, minus one, as a mask) we check whether we've run out of time
+    static const int TimeCheckInterval = 1023;
+    //Time we set aside for talking to whoever asked for our move
+    static const int MoveOverhead = 10;
+    //Assumed number of moves left in the game when we're given our clock without a moves to go
+    static const int DefaultMovesToGo = 30;
+    //How many times our expected time we're allowed to go over by when an iteration runs long
+    static const int HardLimitScale = 4;
+
+    /**
+     * The line of best play the search expects from some node onwards.
+     */
+    struct PrincipalVariation {
+        int length = 0;
+        std::array<Move, MaxDepth> moves;
+    };
+
+    /**
+     * Everything a single search thread needs for itself. Lazy SMP: every thread searches the same position
+     * on its own, and they only help each other through the transposition table they all share.
+     * Since they order their moves differently (their histories diverge), they end up filling in different parts of the tree.
+     */
+    struct SearchThread {
+        static const int MainThread = 0;
+        int id = MainThread;
+        //helpers search a copy of the board, the main thread searches the one it was given
+        std::unique_ptr<Board> board;
+        std::unique_ptr<Evaluator> evaluator;
+        std::shared_ptr<MoveHistory> history;
+        std::vector<std::unique_ptr<MoveOrderer> > moveOrderers;
+        std::array<CentipawnScore, MaxDepth> pastScores{};
+        /**
+         * The principal variation of the last completed iteration, and whether the node at each ply
+         * is still on it (in which case its move is tried first).
+         */
+        PrincipalVariation principalVariation;
+        std::array<bool, MaxDepth + 1> isFollowingPv{};
+        //only ever written by its own thread, but the main thread adds them all up
+        std::atomic<long> nodeCount{0};
+        SearchStatistics::Counters statistics;
+
+        MoveOrderer& getMoveOrderer(int searchPly);
+        void countNode() {
+            nodeCount.store(nodeCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    };
+    std::vector<std::unique_ptr<SearchThread> > threads;
+    long getNodeCount() const;
+    SearchStatistics::Counts getStatisticsCounts() const;
+    /**
+     * Cheap enough to call at every node, since it only looks at the clock every so often.
+     */
+    bool shouldStop(SearchThread& thread);
+    bool isStopped(const SearchThread& thread) const;
+    void reportIteration(const SearchThread& thread, int depth, CentipawnScore score);
+
     MultiArray<CentipawnScore, LateMoveReductionDepth, LateMoveReductionDepth> lmrTable;
-    MultiArray<CentipawnScore, 2, LateMovePruningDepth> lmpTable;
+    MultiArray<CentipawnScore, 2, LateMovePruningDepth + 1> lmpTable;
 
-    std::unordered_map<uint64_t, Move> bestMoves;
-    CentipawnScore getDeltaPruningMargin(Board& board);
-    CentipawnScore quiescence(Board& board, CentipawnScore alpha, CentipawnScore beta);
-    CentipawnScore alphabeta(Board& board, CentipawnScore alpha, CentipawnScore beta, int depth);
+    TranspositionTable transpositionTable;
+    /**
+     * Mate scores are relative to the root, but the table is shared between different roots,
+     * so store them relative to the position instead.
+     */
+    static CentipawnScore scoreToTable(CentipawnScore score, int searchPly);
+    static CentipawnScore scoreFromTable(CentipawnScore score, int searchPly);
+    CentipawnScore getDeltaPruningMargin(SearchThread& thread, Board& board);
+    CentipawnScore quiescence(SearchThread& thread, Board& board, CentipawnScore alpha, CentipawnScore beta);
+    void iterativeDeepening(SearchThread& thread, Board& board, int maxDepth);
+    CentipawnScore aspirationWindow(SearchThread& thread, Board& board, int depth, CentipawnScore previousScore);
+    CentipawnScore alphabeta(SearchThread& thread, Board& board, CentipawnScore alpha, CentipawnScore beta, int depth, PrincipalVariation& pv);
 };
 
 #endif
\ No newline at end of file
@@ -5,11 +5,18 @@
 #include "difficultylevel.h"
 #include "easydifficulty.h"
 #include "fullstrength.h"
+#include "perft.h"
+#include "microbench.h"
+#include "bench.h"
+#include "book.h"
 #include <iostream>
 #include <sstream>
 #include <random>
 #include <regex>
+#include <fstream>
 #include <cmath>
+#include <mutex>
+#include <thread>
 
 /**
  * Maps, for translating piece integers into text-displayed pieces
@@ -17,7 +24,10 @@
 const std::array<char, 12> PieceChar = {'p', 'P', 'n', 'N', 'b', 'B', 'r', 'R', 'q', 'Q', 'k', 'K'};
 const std::array<std::string, 12> PieceImage{"♟", "♙", "♞", "♘", "♝", "♗", "♜", "♖", "♛", "♕", "♚", "♔"};
 
-IO::IO(std::istream& in, std::ostream& out): input{std::make_unique<TextInput>(in)}, out{out} {}
+IO::IO(std::istream& in, std::ostream& out, bool uci): out{out} {
+    if (uci) input = std::make_unique<UciInput>(in);
+    else input = std::make_unique<TextInput>(in);
+}
 
 void IO::makeTextOutput(std::ostream& out) {
     outputs.emplace_back(std::make_unique<TextOutput>(input.get(), out));
@@ -785,6 +795,12 @@ void printSetting(std::ostream& out, int setting, bool currValue) {
  * ╞╴ ./chess
  * │         Captures programmers who have no short-term memory.
  * │         N = 1
+ * ╞╴ bench [depth?]
+ * │         Searches the benchmark positions and prints the speed and node signature.
+ * │         N = 1
+ * ╞╴ book [file|off]
+ * │         Opens an opening book for computers in new games to play from.
+ * │         N = 1
  * ╞╴ close
  * │         Force-quits the current game, without awarding points.
  * │         N = 1
@@ -806,14 +822,24 @@ void printSetting(std::ostream& out, int setting, bool currValue) {
  * ╞╴ make
  * │         Captures programmers who forgot to CTRL+C!
  * │         N = 2
+ * ╞╴ microbench [name?]
+ * │         Times one of the engine's hot loops, or all of them.
+ * │         N = 1
  * ╞╴ move
  * │         Tells the computer to compute and play its move.
  * │         N = 1
  * ╞╴ move [from] [to] [promotion?]
  * │         Plays a move. For example: `move e1 g1` or `move g2 g1 R`.
  * │         N = 16
- * ╞╴ perft [0-15]
- * │         Runs a PERFT test on the current board.
+ * ╞╴ movetime [milliseconds]
+ * │         Caps how long computers think per move. 0 means no cap.
+ * │         N = 1
+ * ╞╴ nnue [file|off]
+ * │         Loads a network file for computers in new games to evaluate with.
+ * │         N = 1
+ * ╞╴ perft [0-15] [hash?]
+ * │         Runs a PERFT test on the current board, using `threads` threads
+ * │         and a `hash` megabyte table (0 for none).
  * │         N = 1
  * ╞╴ print
  * │         Displays the current game.
@@ -869,6 +895,12 @@ void printSetting(std::ostream& out, int setting, bool currValue) {
  *    ╞╴ toggle [right]
  *    │          Toggles the specified castling right.
  * ╭──╯          N = 6
+ * ╞╴ stats [file|off]
+ * │         Appends computers' search statistics to `file` as JSON lines, from the next game on.
+ * │         N = 2
+ * ╞╴ threads [count]
+ * │         Sets how many threads computers search with, from the next game on.
+ * │         N = 1
  * ╞╴ toggle [0-3]
  * │         Toggles the numbered setting.
  * │         N = 1
@@ -878,10 +910,10 @@ void printSetting(std::ostream& out, int setting, bool currValue) {
  * ╰─────╴
  * 
  * Total Error Checks = Normal error-checks + "secret" error-checks:
- * N = 71 + 34 = 105
+ * N = 79 + 34 = 113
  * 
  * Total Number of Commands = Normal commands + "secret" commands:
- * C = 31 + 22 = 53
+ * C = 38 + 22 = 60
  * 
 */
 void TextInput::runProgram(IO& io, std::ostream& out) {
@@ -891,6 +923,23 @@ void TextInput::runProgram(IO& io, std::ostream& out) {
     std::pair<double, double> scores = {0, 0}; // {white, black}
     std::pair<int, int> players = {0, 0}; // 0: player.   1-6: computer[1-6]
     std::pair<std::unique_ptr<DifficultyLevel>, std::unique_ptr<DifficultyLevel>> compPlayers;
+    SearchLimits computerLimits; // How long the computer may think; its level decides how deep.
+    computerLimits.moveTime = 10000;
+    int computerThreads = 1; // How many threads computers search with, from the next game on.
+    bool computerNetwork = false; // Whether computers evaluate with the loaded network, from the next game on.
+    std::shared_ptr<std::ofstream> statisticsFile; // Where computers write their search statistics, if anywhere.
+    std::shared_ptr<const OpeningBook> openingBook; // What computers play their openings from, if anything.
+    auto makeFullStrength = [&computerThreads, &computerNetwork, &statisticsFile, &openingBook](int depthLevel) {
+        std::unique_ptr<FullStrength> level = std::make_unique<FullStrength>(depthLevel);
+        level->setThreadCount(computerThreads);
+        if (computerNetwork) level->setEvaluator(EvalLevelNNUE{});
+        level->setOpeningBook(openingBook); // Shared between games, never copied.
+        if (statisticsFile) {
+            std::shared_ptr<std::ofstream> file = statisticsFile; // Games can outlive the setting.
+            level->setStatisticsHandler([file](const SearchStatistics& statistics) { statistics.writeJsonLines(*file); });
+        }
+        return level;
+    };
 
     bool isGameRunning = false;
 
@@ -963,15 +1012,16 @@ void TextInput::runProgram(IO& io, std::ostream& out) {
                             compPlayers.first = std::make_unique<LevelTwo>();
                             break;
                         case '3':
-                            compPlayers.first = std::make_unique<FullStrength>(3);
+                            compPlayers.first = makeFullStrength(3);
                             break;
                         case '4':
-                            compPlayers.first = std::make_unique<FullStrength>(7);
+                            compPlayers.first = makeFullStrength(7);
                             break;
                         case '5':
-                            compPlayers.first = std::make_unique<FullStrength>(11);
+                            compPlayers.first = makeFullStrength(11);
+                            break;
                         default: // '6'
-                            compPlayers.first = std::make_unique<FullStrength>(15);
+                            compPlayers.first = makeFullStrength(15);
                             break;
                     }
                 }
@@ -984,15 +1034,16 @@ void TextInput::runProgram(IO& io, std::ostream& out) {
                             compPlayers.second = std::make_unique<LevelTwo>();
                             break;
                         case '3':
-                            compPlayers.second = std::make_unique<FullStrength>(3);
+                            compPlayers.second = makeFullStrength(3);
                             break;
                         case '4':
-                            compPlayers.second = std::make_unique<FullStrength>(7);
+                            compPlayers.second = makeFullStrength(7);
                             break;
                         case '5':
-                            compPlayers.second = std::make_unique<FullStrength>(11);
+                            compPlayers.second = makeFullStrength(11);
+                            break;
                         default: // '6'
-                            compPlayers.second = std::make_unique<FullStrength>(15);
+                            compPlayers.second = makeFullStrength(15);
                             break;
                     }
                 }
@@ -1036,9 +1087,9 @@ void TextInput::runProgram(IO& io, std::ostream& out) {
             if (isGameRunning) {
                 if (first == "") { // Do computer move!
                     if ((players.first && !turn) || (players.second && turn)) {
-                        Move move = (turn ? compPlayers.second : compPlayers.first).get()->getMove(board);
+                        Move move = (turn ? compPlayers.second : compPlayers.first).get()->getMove(board, computerLimits);
 
-                        board.applyMove(move);
+                        board.playMove(move);
 
                         if (!board.countLegalMoves() || board.isDrawn()) { // Game is over
                             if (board.isSideInCheck(turn)) { // In Check
@@ -1127,7 +1178,7 @@ void TextInput::runProgram(IO& io, std::ostream& out) {
                                 bool pseudoLegal = board.isMovePseudoLegal(move);
 
                                 if (pseudoLegal) {
-                                    bool fullyLegal = board.applyMove(move);
+                                    bool fullyLegal = board.playMove(move);
                                     if (fullyLegal) {
                                         Color turn = board.getTurn();
                                         if (!board.countLegalMoves() || board.isDrawn()) { // Game is over
@@ -1406,6 +1457,10 @@ void TextInput::runProgram(IO& io, std::ostream& out) {
             out << " ◌ ╭─────╴" << std::endl;
             out << " ◌ ╞╴ ./chess" << std::endl;
             out << " ◌ │         Captures programmers who have no short-term memory." << std::endl;
+            out << " ◌ ╞╴ bench [depth?]" << std::endl;
+            out << " ◌ │         Searches the benchmark positions and prints the speed and node signature." << std::endl;
+            out << " ◌ ╞╴ book [file|off]" << std::endl;
+            out << " ◌ │         Opens an opening book for computers in new games to play from." << std::endl;
             out << " ◌ ╞╴ close" << std::endl;
             out << " ◌ │         Force-quits the current game, without awarding points." << std::endl;
             out << " ◌ ╞╴ exit" << std::endl;
@@ -1420,12 +1475,19 @@ void TextInput::runProgram(IO& io, std::ostream& out) {
             out << " ◌ │         Opens this manual." << std::endl;
             out << " ◌ ╞╴ make" << std::endl;
             out << " ◌ │         Captures programmers who forgot to CTRL+C." << std::endl;
+            out << " ◌ ╞╴ microbench [name?]" << std::endl;
+            out << " ◌ │         Times one of the engine's hot loops, or all of them." << std::endl;
             out << " ◌ ╞╴ move" << std::endl;
             out << " ◌ │         Tells the computer to compute and play its move." << std::endl;
             out << " ◌ ╞╴ move [from] [to] [promotion?]" << std::endl;
             out << " ◌ │         Plays a move. For example: `move e1 g1` or `move g2 g1 R`." << std::endl;
-            out << " ◌ ╞╴ perft [0-15]" << std::endl;
-            out << " ◌ │         Runs a PERFT test on the current board." << std::endl;
+            out << " ◌ ╞╴ movetime [milliseconds]" << std::endl;
+            out << " ◌ │         Caps how long computers think per move. 0 means no cap." << std::endl;
+            out << " ◌ ╞╴ nnue [file|off]" << std::endl;
+            out << " ◌ │         Loads a network file for computers in new games to evaluate with." << std::endl;
+            out << " ◌ ╞╴ perft [0-15] [hash?]" << std::endl;
+            out << " ◌ │         Runs a PERFT test on the current board, using `threads` threads" << std::endl;
+            out << " ◌ │         and a `hash` megabyte table (0 for none)." << std::endl;
             out << " ◌ ╞╴ print" << std::endl;
             out << " ◌ │         Displays the current game." << std::endl;
             out << " ◌ ╞╴ quit" << std::endl;
@@ -1462,6 +1524,10 @@ void TextInput::runProgram(IO& io, std::ostream& out) {
             out << " ◌    │          Displays the current board." << std::endl;
             out << " ◌    ╞╴ toggle [right]" << std::endl;
             out << " ◌ ╭──╯          Toggles the specified castling right." << std::endl;
+            out << " ◌ ╞╴ stats [file|off]" << std::endl;
+            out << " ◌ │         Appends computers' search statistics to `file` as JSON lines, from the next game on." << std::endl;
+            out << " ◌ ╞╴ threads [count]" << std::endl;
+            out << " ◌ │         Sets how many threads computers search with, from the next game on." << std::endl;
             out << " ◌ ╞╴ toggle [0-3]" << std::endl;
             out << " ◌ │         Toggles the numbered setting." << std::endl;
             out << " ◌ ╞╴ undo" << std::endl;
@@ -1469,8 +1535,8 @@ void TextInput::runProgram(IO& io, std::ostream& out) {
             out << " ◌ ╰─────╴" << std::endl;
         } else if (command == "undo") {
             if (isGameRunning) {
-                if (board.getTotalPlies() > 1) {
-                    board.revertMostRecent();
+                if (!board.getLastPlayedMove().isMoveNone()) {
+                    board.revertPlayedMove();
                     io.fullDisplay(board, GameState::Neutral, totalGames, players);
                 } else {
                     out << " ◌ The game has no moves to undo." << std::endl;
@@ -1498,13 +1564,108 @@ void TextInput::runProgram(IO& io, std::ostream& out) {
                 out << " ◌ Usage:  toggle [0-3]" << std::endl;
                 out << " ◌ Type `settings` for the setting list." << std::endl;
             }
+        } else if (command == "movetime") {
+            int n = -1;
+            lineStream >> n;
+            if (lineStream && n >= 0) {
+                computerLimits.moveTime = n;
+                if (n) out << " ◌ Computers will now think for at most " << n << " milliseconds per move." << std::endl;
+                else out << " ◌ Computers will now think for as long as their level needs." << std::endl;
+            } else {
+                out << " ◌ Usage:  movetime [milliseconds]" << std::endl;
+                out << " ◌ Currently " << computerLimits.moveTime << ". Use 0 for no limit." << std::endl;
+            }
+        } else if (command == "stats") {
+            std::string file;
+            lineStream >> file;
+            if (!SearchStatistics::Enabled) {
+                out << " ◌ Search statistics aren't built in. Rebuild with `make clean && make STATS=1`." << std::endl;
+            } else if (file == "off") {
+                statisticsFile = nullptr;
+                out << " ◌ Computers in new games won't write their search statistics." << std::endl;
+            } else if (!file.empty()) {
+                std::shared_ptr<std::ofstream> opened = std::make_shared<std::ofstream>(file, std::ios::app);
+                if (*opened) {
+                    statisticsFile = opened;
+                    out << " ◌ Computers in new games will append their search statistics to `" << file << "`." << std::endl;
+                } else {
+                    out << " ◌ Could not open `" << file << "`." << std::endl;
+                }
+            } else {
+                out << " ◌ Usage:  stats [file|off]" << std::endl;
+            }
+        } else if (command == "threads") {
+            int n = -1;
+            lineStream >> n;
+            if (lineStream && n >= 1) {
+                computerThreads = n;
+                out << " ◌ Computers in new games will search with " << n << (n == 1 ? " thread." : " threads.") << std::endl;
+            } else {
+                out << " ◌ Usage:  threads [count]" << std::endl;
+                out << " ◌ Currently " << computerThreads << "." << std::endl;
+            }
+        } else if (command == "bench") {
+            int n = Bench::DefaultDepth;
+            if (!(lineStream >> n)) n = Bench::DefaultDepth;
+            if (n >= 1 && n < MaxDepth) {
+                Bench::run(n, out);
+            } else {
+                out << " ◌ Usage:  bench [depth?]" << std::endl;
+            }
+        } else if (command == "microbench") {
+            std::string name = "all";
+            lineStream >> name;
+            if (!Microbenchmark::run(name, out)) {
+                out << " ◌ Usage:  microbench [name?]" << std::endl;
+                out << " ◌ Options are:";
+                for (const std::string& option : Microbenchmark::getNames()) out << " `" << option << "`";
+                out << "." << std::endl;
+            }
+        } else if (command == "nnue") {
+            std::string file;
+            lineStream >> file;
+            if (file == "off") {
+                computerNetwork = false;
+                out << " ◌ Computers in new games will evaluate by hand." << std::endl;
+            } else if (!file.empty() && Network::getNetwork().load(file)) {
+                computerNetwork = true;
+                out << " ◌ Computers in new games will evaluate with `" << file << "` (" << Network::getNetwork().getKernelName() << ")." << std::endl;
+            } else {
+                if (!file.empty()) out << " ◌ Could not load a network from `" << file << "`." << std::endl;
+                out << " ◌ Usage:  nnue [file|off]" << std::endl;
+                out << " ◌ Currently " << (computerNetwork ? "on." : "off.") << std::endl;
+            }
+        } else if (command == "book") {
+            std::string file;
+            lineStream >> file;
+            std::shared_ptr<const OpeningBook> opened = file.empty() || file == "off" ? nullptr : OpeningBook::open(file);
+            if (file == "off") {
+                openingBook = nullptr;
+                out << " ◌ Computers in new games will think from the first move." << std::endl;
+            } else if (opened) {
+                openingBook = opened;
+                out << " ◌ Computers in new games will play from `" << file << "` (" << opened->getEntryCount() << " entries)." << std::endl;
+            } else {
+                if (!file.empty()) out << " ◌ Could not open a book from `" << file << "`." << std::endl;
+                out << " ◌ Usage:  book [file|off]" << std::endl;
+                out << " ◌ Currently " << (openingBook ? "on." : "off.") << std::endl;
+            }
         } else if (command == "perft") {
             int n = -1;
+            int hash = Perft::DefaultHashSizeMegabytes;
             lineStream >> n;
             if (lineStream && n >= 0 && n <= 15) {
-                board.perftTest(n);
+                if (!(lineStream >> hash) || hash < 0) hash = Perft::DefaultHashSizeMegabytes;
+                Perft perft{computerThreads, hash};
+                Perft::Result result = perft.run(board, n);
+                out << " ◌ Perft test generated " << result.nodes << " in " << result.milliseconds << " milliseconds";
+                out << " (" << result.getNodesPerSecond() << " nodes per second)." << std::endl;
+                out << " ◌ Divide tree:" << std::endl;
+                for (auto const& x : result.divide) {
+                    out << " ◌ " << x.first.toString() << ":" << x.second << std::endl;
+                }
             } else {
-                out << " ◌ Usage:  perft [0-15]" << std::endl;
+                out << " ◌ Usage:  perft [0-15] [hash?]" << std::endl;
             }
         } else if (command == "graphics") {
             int first = -1;
@@ -1574,3 +1735,225 @@ void TextInput::runProgram(IO& io, std::ostream& out) {
     out << " ◌ " << std::endl;
     out << " ◌ Thanks for using the Hagnus Miemann Chess Engine!" << std::endl << std::endl;
 }
+
+
+
+void UciInput::attach(Output* output) {
+    outputs.emplace_back(output);
+}
+
+void UciInput::detach(Output* output) {
+    for (auto it = outputs.begin(); it != outputs.end(); ++it) {
+        if (*it == output) {
+            outputs.erase(it);
+            break;
+        }
+    }
+}
+
+void UciInput::notifyOutputs(Board& board, std::array<bool, 4> settings, GameState state, bool setup, bool firstSetup) {
+    for (auto out : outputs) out->display(board, settings, state, setup, firstSetup);
+}
+
+/**
+ * Finds the legal move written in UCI notation (e.g. e2e4, e7e8q, e1g1), or gives back an empty move.
+ */
+Move moveFromUciString(Board& board, const std::string& string) {
+    MoveList moveList;
+    board.generateAllLegalMoves(moveList);
+    for (const Move& move : moveList) {
+        if (move.toUciString() == string) return move;
+    }
+    return Move{};
+}
+
+/**
+ * The Universal Chess Interface. Supports the commands:
+ * 
+ * ╭─────╴
+ * ╞╴ uci, isready, ucinewgame, quit
+ * ╞╴ setoption name [Hash|Threads] value [n]
+ * ╞╴ setoption name EvalFile value [file]
+ * ╞╴ setoption name BookFile value [file]
+ * ╞╴ setoption name StatsFile value [file]
+ * ╞╴ position [startpos|fen [FEN]] moves [moves...]
+ * ╞╴ go [depth|movetime|nodes|wtime|btime|winc|binc|movestogo] [n]... [infinite?]
+ * ╞╴ go perft [depth]
+ * ╞╴ stop
+ * ╰─────╴
+ */
+void UciInput::runProgram(IO& io, std::ostream& out) {
+    const std::string StartingFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    const int MaxHash = 4096; // In megabytes.
+    const int MaxThreads = 256;
+
+    Board board = Board::createBoardFromFEN(StartingFEN);
+    board.validateLegality();
+    // The depth level is only a cap, so at full strength the GUI's limits are what stop the search.
+    std::unique_ptr<FullStrength> engine = std::make_unique<FullStrength>(MaxDepth - 1);
+
+    int threads = 1; // For perft, the engine keeps its own count.
+    std::thread searchThread;
+    std::atomic<bool> stopSearch{false};
+    std::mutex outMutex; // The search thread talks too, so lines must not interleave.
+    auto send = [&out, &outMutex](const std::string& line) {
+        std::lock_guard<std::mutex> lock{outMutex};
+        out << line << std::endl;
+    };
+    // Every command but `isready` and `stop` has to wait for the search to be over.
+    auto finishSearch = [&searchThread, &stopSearch]() {
+        if (searchThread.joinable()) {
+            stopSearch = true;
+            searchThread.join();
+        }
+    };
+
+    engine->setInfoHandler([&send](const FullStrength::SearchInfo& info) {
+        std::ostringstream line;
+        line << "info depth " << info.depth;
+        if (info.mateIn) line << " score mate " << info.mateIn;
+        else line << " score cp " << info.score;
+        line << " nodes " << info.nodes << " nps " << info.nodes * 1000 / std::max(1l, info.milliseconds);
+        line << " time " << info.milliseconds << " hashfull " << info.hashfull << " pv";
+        for (const Move& move : info.principalVariation) line << " " << move.toUciString();
+        send(line.str());
+    });
+
+    std::string currLine;
+    while (std::getline(in, currLine)) {
+        std::string command;
+        std::istringstream lineStream{currLine};
+        lineStream >> command;
+
+        if (command == "uci") {
+            send("id name Hagnus Miemann");
+            send("id author Alex, Josiah, and Justin");
+            send("option name Hash type spin default " + std::to_string(TranspositionTable::DefaultSizeMegabytes) + " min 1 max " + std::to_string(MaxHash));
+            send("option name Threads type spin default 1 min 1 max " + std::to_string(MaxThreads));
+            send("option name EvalFile type string default <empty>");
+            send("option name BookFile type string default <empty>");
+            if (SearchStatistics::Enabled) send("option name StatsFile type string default <empty>");
+            send("uciok");
+        } else if (command == "isready") {
+            send("readyok");
+        } else if (command == "ucinewgame") {
+            finishSearch();
+            engine->newGame();
+        } else if (command == "setoption") {
+            finishSearch();
+            std::string token, name, value;
+            // Option names may have spaces in them, so gather everything up to "value".
+            lineStream >> token;
+            while (lineStream >> token && token != "value") name += (name.empty() ? "" : " ") + token;
+            // Values may have spaces in them too (file names), so take the rest of the line.
+            std::getline(lineStream >> std::ws, value);
+            try {
+                if (name == "Hash") engine->setHashSize(std::max(1, std::min(MaxHash, std::stoi(value))));
+                else if (name == "Threads") {
+                    threads = std::max(1, std::min(MaxThreads, std::stoi(value)));
+                    engine->setThreadCount(threads);
+                }
+                else if (name == "StatsFile" && SearchStatistics::Enabled) {
+                    // Search statistics get appended as JSON lines after every search.
+                    if (value.empty() || value == "<empty>") engine->setStatisticsHandler(nullptr);
+                    else {
+                        std::shared_ptr<std::ofstream> file = std::make_shared<std::ofstream>(value, std::ios::app);
+                        if (*file) engine->setStatisticsHandler([file](const SearchStatistics& statistics) { statistics.writeJsonLines(*file); });
+                        else send("info string could not open " + value);
+                    }
+                }
+                else if (name == "EvalFile") {
+                    // No file means the handwritten evaluation.
+                    if (value.empty() || value == "<empty>") engine->setEvaluator(EvalLevelFour{});
+                    else if (Network::getNetwork().load(value)) {
+                        engine->setEvaluator(EvalLevelNNUE{});
+                        send("info string loaded " + value + " using " + Network::getNetwork().getKernelName());
+                    } else {
+                        engine->setEvaluator(EvalLevelFour{});
+                        send("info string could not load " + value);
+                    }
+                }
+                else if (name == "BookFile") {
+                    // No file means searching every move.
+                    std::shared_ptr<const OpeningBook> book = value.empty() || value == "<empty>" ? nullptr : OpeningBook::open(value);
+                    if (!book && !value.empty() && value != "<empty>") send("info string could not open " + value);
+                    engine->setOpeningBook(book);
+                }
+                else send("info string unknown option " + name);
+            } catch (const std::logic_error&) {
+                send("info string invalid value for " + name);
+            }
+        } else if (command == "position") {
+            finishSearch();
+            std::string token;
+            lineStream >> token;
+            if (token == "startpos") {
+                board = Board::createBoardFromFEN(StartingFEN);
+                lineStream >> token;
+            } else if (token == "fen") {
+                std::string fen;
+                while (lineStream >> token && token != "moves") fen += (fen.empty() ? "" : " ") + token;
+                board = Board::createBoardFromFEN(fen);
+            } else {
+                send("info string expected startpos or fen");
+                continue;
+            }
+            board.validateLegality();
+            if (token == "moves") {
+                while (lineStream >> token) {
+                    Move move = moveFromUciString(board, token);
+                    if (move.isMoveNone()) {
+                        send("info string illegal move " + token);
+                        break;
+                    }
+                    board.playMove(move);
+                }
+            }
+        } else if (command == "go") {
+            finishSearch();
+            SearchLimits limits;
+            bool infinite = false;
+            std::string token;
+            int perftDepth = -1;
+            while (lineStream >> token) {
+                if (token == "perft") lineStream >> perftDepth;
+                else if (token == "infinite") infinite = true;
+                else if (token == "depth") lineStream >> limits.depth;
+                else if (token == "nodes") lineStream >> limits.nodes;
+                else if (token == "movetime") lineStream >> limits.moveTime;
+                else if (token == "wtime") lineStream >> limits.time[White];
+                else if (token == "btime") lineStream >> limits.time[Black];
+                else if (token == "winc") lineStream >> limits.increment[White];
+                else if (token == "binc") lineStream >> limits.increment[Black];
+                else if (token == "movestogo") lineStream >> limits.movesToGo;
+            }
+            if (perftDepth >= 0) {
+                // The same divide format as other engines, so the counts can be compared move by move.
+                Perft perft{threads};
+                Perft::Result result = perft.run(board, perftDepth);
+                for (auto const& x : result.divide) send(x.first.toUciString() + ": " + std::to_string(x.second));
+                send("");
+                send("Nodes searched: " + std::to_string(result.nodes));
+                send("info string time " + std::to_string(result.milliseconds) + " nps " + std::to_string(result.getNodesPerSecond()));
+                continue;
+            }
+            if (!board.countLegalMoves()) {
+                send("bestmove 0000");
+                continue;
+            }
+            stopSearch = false;
+            limits.stop = &stopSearch;
+            searchThread = std::thread([&engine, &stopSearch, &send, limits, infinite, board = board.cloneForSearch()]() mutable {
+                Move move = engine->getMove(board, limits);
+                // An infinite search must not give its answer until it's told to stop.
+                while (infinite && !stopSearch) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                send("bestmove " + move.toUciString());
+            });
+        } else if (command == "stop") {
+            finishSearch();
+        } else if (command == "quit") {
+            break;
+        }
+    }
+    finishSearch();
+}
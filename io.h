@@ -10,6 +10,7 @@
 class Input;
 class Output;
 class TextInput;
+class UciInput;
 
 /**
  * IO is a meta-object, to hold the Outputs [observers] and
@@ -32,7 +33,11 @@ class IO {
     void initialize(bool setup, std::string white, std::string black, int game);
     void display(Board& board, GameState state, bool setup = false, bool firstSetup = false);
 public:
-    IO(std::istream& in, std::ostream& out);
+    /**
+     * With `uci` set, we speak the Universal Chess Interface instead of our own shell,
+     * so that chess GUIs and match runners can drive the engine.
+     */
+    IO(std::istream& in, std::ostream& out, bool uci = false);
     void makeTextOutput(std::ostream& out);
     void makeGraphicOutput(int size);
 
@@ -103,6 +108,7 @@ public:
      * Get this whole big baby ROLLIN'!!!
      */
     virtual void runProgram(IO& io, std::ostream& out) = 0;
+    virtual ~Input() = default;
 };
 
 // [Observer Pattern] Concrete Subject #1
@@ -121,4 +127,21 @@ public:
     void runProgram(IO& io, std::ostream& out) override;
 };
 
+// [Observer Pattern] Concrete Subject #2
+// Nothing ever observes this one, since a UCI GUI draws the board itself.
+class UciInput: public Input {
+    std::istream& in;
+public:
+    UciInput(std::istream& in): in{in} {};
+    void attach(Output* output) override;
+    void detach(Output* output) override;
+    void notifyOutputs(Board& board, std::array<bool, 4> settings, GameState state, bool setup, bool firstSetup) override;
+
+    /**
+     * Answers UCI commands until `quit` (or EOF). Searches run on a worker thread,
+     * so `stop` and `isready` are answered while the engine is thinking.
+     */
+    void runProgram(IO& io, std::ostream& out) override;
+};
+
 #endif
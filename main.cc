@@ -1,14 +1,37 @@
+#include "bench.h"
+#include "book.h"
 #include "io.h"
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <string>
 
-int main() {
+int main(int argc, char* argv[]) {
     /**
      * Create an Input-Output object,
      * to hold our entire program.
      * 
-     * See in io.cc, TextInput::runProgram() for the full input system.
+     * See in io.cc, TextInput::runProgram() for the full input system,
+     * or UciInput::runProgram() for the one GUIs use (`./chess --uci`).
+     * `./chess bench [depth?]` just runs the benchmark (see bench.h) and exits.
+     * `./chess makebook [games] [book] [plies?]` writes an opening book from a file of games (see book.h) and exits.
      */
-    IO io{std::cin, std::cout};
+    if (argc > 1 && std::string{argv[1]} == "bench") {
+        int depth = argc > 2 ? std::atoi(argv[2]) : Bench::DefaultDepth;
+        Bench::run(depth > 0 ? depth : Bench::DefaultDepth, std::cout);
+        return 0;
+    }
+    if (argc > 3 && std::string{argv[1]} == "makebook") {
+        std::ifstream games{argv[2]};
+        if (!games) {
+            std::cout << " ◌ Could not open `" << argv[2] << "`." << std::endl;
+            return 1;
+        }
+        int plies = argc > 4 ? std::atoi(argv[4]) : OpeningBook::DefaultBuildPlies;
+        return OpeningBook::build(games, argv[3], plies > 0 ? plies : OpeningBook::DefaultBuildPlies, std::cout) ? 0 : 1;
+    }
+    bool uci = argc > 1 && std::string{argv[1]} == "--uci";
+    IO io{std::cin, std::cout, uci};
     
     io.runProgram();
 
@@ -0,0 +1,406 @@
+#include "microbench.h"
+#include "evaluator.h"
+#include "moveorder.h"
+#include "perft.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+bool Microbenchmark::run(const std::string& name, std::ostream& out) {
+    bool found = false;
+    for(const Benchmark& benchmark : getBenchmarks()) {
+        if(name == "all" || name == benchmark.name) {
+            benchmark.run(out);
+            found = true;
+        }
+    }
+    return found;
+}
+
+std::vector<std::string> Microbenchmark::getNames() {
+    std::vector<std::string> names;
+    for(const Benchmark& benchmark : getBenchmarks()) {
+        names.emplace_back(benchmark.name);
+    }
+    return names;
+}
+
+const std::vector<Microbenchmark::Benchmark>& Microbenchmark::getBenchmarks() {
+    static const std::vector<Benchmark> benchmarks = {
+        {"makemove", makeMoves},
+        {"eval", evaluate},
+        {"sliders", sliders},
+        {"repetition", repetitions},
+        {"checks", checks},
+        {"see", exchanges}
+    };
+    return benchmarks;
+}
+
+std::vector<Board> Microbenchmark::getPositions() {
+    static const std::vector<std::string> fens = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "2r3k1/pp3ppp/4p3/3pP3/3P4/P4N2/1P3PPP/2R3K1 b - - 0 25",
+        "8/5pk1/6p1/8/3K4/6P1/5P2/8 w - - 0 50"
+    };
+    std::vector<Board> positions;
+    for(const std::string& fen : fens) {
+        positions.emplace_back(Board::createBoardFromFEN(fen));
+        positions.back().validateLegality();
+    }
+    return positions;
+}
+
+void Microbenchmark::report(std::ostream& out, const std::string& label, long iterations, long operationsPerCall, const std::function<void()>& body) {
+    //one untimed call to warm the caches up
+    body();
+    auto start = std::chrono::steady_clock::now();
+    for(long i = 0; i < iterations; i++) {
+        body();
+    }
+    long microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    double perSecond = (double)iterations * operationsPerCall / std::max(1l, microseconds);
+    out << " ◌ " << label << ": " << perSecond << " million per second (" << microseconds / 1000 << " milliseconds)" << std::endl;
+}
+
+void Microbenchmark::makeMoves(std::ostream& out) {
+    std::vector<Board> positions = getPositions();
+    std::vector<MoveList> moveLists(positions.size());
+    long movesPerCall = 0;
+    for(size_t i = 0; i < positions.size(); i++) {
+        movesPerCall += positions[i].generateAllLegalMoves(moveLists[i]);
+    }
+
+    report(out, "make/unmake", 200000, movesPerCall, [&positions, &moveLists]() {
+        Board::UndoData undo;
+        for(size_t i = 0; i < positions.size(); i++) {
+            for(Move& move : moveLists[i]) {
+                positions[i].applyMoveWithUndo(move, undo);
+                positions[i].revertMove(undo);
+            }
+        }
+    });
+}
+
+void Microbenchmark::evaluate(std::ostream& out) {
+    //every position one move away from the usual ones too, so there's a spread of pawn structures and piece placements
+    std::vector<Board> positions;
+    for(Board& board : getPositions()) {
+        MoveList moveList;
+        board.generateAllLegalMoves(moveList);
+        positions.push_back(board.clonePosition());
+        for(Move& move : moveList) {
+            board.applyMove(move);
+            positions.push_back(board.clonePosition());
+            board.revertMostRecent();
+        }
+    }
+    volatile long sink = 0;
+
+    report(out, "eval terms", 20000, positions.size(), [&]() {
+        long total = 0;
+        for(Board& board : positions) {
+            Bitboard openFiles = board.getOpenFiles();
+            for(Color side : {White, Black}) {
+                Bitboard semiOpenFiles = board.getSemiOpenFiles(side);
+                total += board.getNumberOfIsolatedPawns(side) + board.getNumberOfPassedPawns(side);
+                total += Board::popCnt(board.getPieces(side, Rook) & openFiles) + Board::popCnt(board.getPieces(side, Rook) & semiOpenFiles);
+                total += Board::popCnt(board.getPieces(side, Queen) & openFiles) + Board::popCnt(board.getPieces(side, Queen) & semiOpenFiles);
+            }
+        }
+        sink = sink + total;
+    });
+
+    EvalLevelFour evaluator;
+    report(out, "staticEvaluate", 20000, positions.size(), [&]() {
+        long total = 0;
+        for(Board& board : positions) {
+            total += evaluator.staticEvaluate(board);
+        }
+        sink = sink + total;
+    });
+}
+
+void Microbenchmark::sliders(std::ostream& out) {
+    Board::PrecomputedBinary& binary = Board::PrecomputedBinary::getBinary();
+    const bool wasPext = binary.isPextEnabled();
+    if(!binary.setPextEnabled(true)) {
+        out << " ◌ This CPU can't do PEXT, so there's only the magic tables to time." << std::endl;
+    }
+    const bool hasPext = binary.isPextEnabled();
+    std::vector<Board> positions = getPositions();
+
+    //every slider on every square of the usual positions, plus random occupancies to cover the odd ones
+    std::vector<std::pair<Square, Bitboard>> lookups;
+    for(Board& board : positions) {
+        for(int square = a1; square <= h8; square++) {
+            lookups.emplace_back(Board::getSquare(square), board.sides[White] | board.sides[Black]);
+        }
+    }
+    std::mt19937_64 random{2022};
+    for(int i = 0; i < 4096; i++) {
+        lookups.emplace_back(Board::getSquare(i % NumSquares), random() & random());
+    }
+
+    if(hasPext) {
+        //both backends have to agree on every attack...
+        bool agree = true;
+        for(auto const& x : lookups) {
+            binary.setPextEnabled(false);
+            Bitboard magic = binary.getQueenAttacksFromSquare(x.first, x.second);
+            binary.setPextEnabled(true);
+            agree = agree && magic == binary.getQueenAttacksFromSquare(x.first, x.second);
+        }
+        //...and so on every perft
+        Perft perft{1, 0};
+        for(Board& board : positions) {
+            binary.setPextEnabled(false);
+            uint64_t magic = perft.run(board, 3).nodes;
+            binary.setPextEnabled(true);
+            agree = agree && magic == perft.run(board, 3).nodes;
+        }
+        out << " ◌ The magic and PEXT attacks " << (agree ? "agree." : "DISAGREE!") << std::endl;
+    }
+
+    volatile Bitboard sink = 0;
+    auto lookupAll = [&lookups, &binary, &sink]() {
+        Bitboard total = 0;
+        for(auto const& x : lookups) {
+            total ^= binary.getBishopAttacksFromSquare(x.first, x.second) ^ binary.getRookAttacksFromSquare(x.first, x.second);
+        }
+        sink = sink ^ total;
+    };
+    binary.setPextEnabled(false);
+    report(out, "slider attacks (magic)", 2000, 2 * lookups.size(), lookupAll);
+    if(hasPext) {
+        binary.setPextEnabled(true);
+        report(out, "slider attacks (pext)", 2000, 2 * lookups.size(), lookupAll);
+    }
+    binary.setPextEnabled(wasPext);
+}
+
+void Microbenchmark::repetitions(std::ostream& out) {
+    //endgames shuffled around at random (no captures, pawn moves or castling) for most of a fifty move rule,
+    //which is where the history to look back through gets longest, keeping every position along the way
+    static const std::vector<std::string> fens = {
+        "8/8/4k3/3r4/8/3R4/4K3/8 w - - 0 1",
+        "8/5k2/8/2q5/8/4Q3/1K6/8 w - - 0 1",
+        "6k1/5pp1/8/8/3N4/8/2B2PP1/6K1 w - - 0 1",
+        "4k3/8/2n5/8/8/5B2/8/3RK3 w - - 0 1",
+        "8/3k4/8/1r6/8/6N1/2R2K2/8 b - - 0 1"
+    };
+    std::mt19937 random{2022};
+    auto isReversible = [](const Board& board, const Move& move) {
+        return move.getMoveType() == Move::MoveType::Normal && getPieceType(board.getPieceAt(move.getFrom())) != Pawn
+            && board.getPieceAt(move.getTo()) == Empty;
+    };
+    //the slow but sure way: try every move, and see if it lands on a position we've had before
+    auto hasUpcomingRepetitionByMoves = [&isReversible](Board& board) {
+        MoveList moveList;
+        board.generateAllLegalMoves(moveList);
+        for(Move& move : moveList) {
+            if(isReversible(board, move)) {
+                board.applyMove(move);
+                bool repeated = board.isRepetition(MaxDepth);
+                board.revertMostRecent();
+                if(repeated) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+    //every upcoming repetition has to be found (the table can also find some that need an illegal move, which is fine)
+    std::vector<Board> positions;
+    long found = 0;
+    long missed = 0;
+    for(const std::string& fen : fens) {
+        Board board = Board::createBoardFromFEN(fen);
+        board.validateLegality();
+        for(int ply = 0; ply < 90; ply++) {
+            MoveList moveList;
+            board.generateAllLegalMoves(moveList);
+            std::vector<Move> reversible;
+            for(Move& move : moveList) {
+                if(isReversible(board, move)) {
+                    reversible.push_back(move);
+                }
+            }
+            if(reversible.empty()) {
+                break;
+            }
+            board.playMove(reversible[random() % reversible.size()]);
+            positions.push_back(board);
+            bool byCuckoo = board.hasUpcomingRepetition(MaxDepth);
+            found += byCuckoo;
+            missed += !byCuckoo && hasUpcomingRepetitionByMoves(board);
+        }
+    }
+    out << " ◌ " << found << " of " << positions.size() << " positions can repeat next move, ";
+    out << (missed == 0 ? "none missed." : std::to_string(missed) + " MISSED!") << std::endl;
+
+    volatile long sink = 0;
+    report(out, "repetition checks", 20000, positions.size(), [&positions, &sink]() {
+        long total = 0;
+        for(Board& board : positions) {
+            total += board.isRepetition(MaxDepth);
+        }
+        sink = sink + total;
+    });
+    report(out, "upcoming repetition checks", 20000, positions.size(), [&positions, &sink]() {
+        long total = 0;
+        for(Board& board : positions) {
+            total += board.hasUpcomingRepetition(MaxDepth);
+        }
+        sink = sink + total;
+    });
+}
+
+void Microbenchmark::checks(std::ostream& out) {
+    //the positions and everything two moves on from them, which gets plenty of checks (and so check evasions) in
+    std::vector<Board> positions;
+    for(Board& root : getPositions()) {
+        MoveList rootMoves;
+        root.generateAllLegalMoves(rootMoves);
+        for(Move& rootMove : rootMoves) {
+            root.applyMove(rootMove);
+            MoveList childMoves;
+            root.generateAllLegalMoves(childMoves);
+            for(Move& childMove : childMoves) {
+                root.applyMove(childMove);
+                positions.push_back(root.clonePosition());
+                root.revertMostRecent();
+            }
+            root.revertMostRecent();
+        }
+    }
+
+    //the quiet checks have to be exactly the legal quiet moves that give check (whether a move gives check is itself checked below)
+    auto contains = [](MoveList& moveList, const Move& move) {
+        return std::find(moveList.begin(), moveList.end(), move) != moveList.end();
+    };
+    long total = 0;
+    long wrong = 0;
+    for(Board& board : positions) {
+        MoveList legal;
+        MoveList quiets;
+        MoveList direct;
+        board.generateAllLegalMoves(legal);
+        board.generateAllQuietMoves(quiets);
+        board.generateQuietChecks(direct);
+        int expected = 0;
+        int found = 0;
+        int generated = 0;
+        for(Move& move : legal) {
+            bool quietCheck = contains(quiets, move) && board.givesCheck(move);
+            expected += quietCheck;
+            found += quietCheck && contains(direct, move);
+        }
+        for(Move& move : direct) {
+            generated += contains(legal, move);
+        }
+        total += expected;
+        wrong += found != expected || generated != expected;
+    }
+    out << " ◌ " << total << " quiet checks in " << positions.size() << " positions, ";
+    out << (wrong == 0 ? "all found." : std::to_string(wrong) + " positions WRONG!") << std::endl;
+
+    volatile long sink = 0;
+    report(out, "quiet check generation", 200, positions.size(), [&positions, &sink]() {
+        long found = 0;
+        for(Board& board : positions) {
+            MoveList moveList;
+            board.generateQuietChecks(moveList);
+            found += moveList.size();
+        }
+        sink = sink + found;
+    });
+    //and whether a move gives check has to match what making it says, for every kind of move
+    std::vector<MoveList> moveLists(positions.size());
+    long moves = 0;
+    long checking = 0;
+    long mismatched = 0;
+    Board::UndoData undo;
+    for(size_t i = 0; i < positions.size(); i++) {
+        moves += positions[i].generateAllLegalMoves(moveLists[i]);
+        for(Move& move : moveLists[i]) {
+            bool predicted = positions[i].givesCheck(move);
+            positions[i].applyMoveWithUndo(move, undo);
+            checking += positions[i].isCurrentTurnInCheck();
+            mismatched += predicted != positions[i].isCurrentTurnInCheck();
+            positions[i].revertMove(undo);
+        }
+    }
+    out << " ◌ " << checking << " of " << moves << " moves give check, ";
+    out << (mismatched == 0 ? "all predicted." : std::to_string(mismatched) + " MISPREDICTED!") << std::endl;
+    report(out, "gives check", 200, moves, [&positions, &moveLists, &sink]() {
+        long found = 0;
+        for(size_t i = 0; i < positions.size(); i++) {
+            for(Move& move : moveLists[i]) {
+                found += positions[i].givesCheck(move);
+            }
+        }
+        sink = sink + found;
+    });
+}
+
+void Microbenchmark::exchanges(std::ostream& out) {
+    //the positions and everything a move on from them, with every move in each (the search uses SEE on quiet moves too)
+    std::vector<Board> positions;
+    for(Board& root : getPositions()) {
+        MoveList rootMoves;
+        root.generateAllLegalMoves(rootMoves);
+        positions.push_back(root.clonePosition());
+        for(Move& rootMove : rootMoves) {
+            root.applyMove(rootMove);
+            positions.push_back(root.clonePosition());
+            root.revertMostRecent();
+        }
+    }
+    std::vector<MoveList> moveLists(positions.size());
+    long moves = 0;
+    for(size_t i = 0; i < positions.size(); i++) {
+        moves += positions[i].generateAllLegalMoves(moveLists[i]);
+    }
+
+    //sharing the attackers between moves to the same square mustn't change any answers
+    HeuristicMoveOrderer orderer;
+    long losing = 0;
+    long different = 0;
+    for(size_t i = 0; i < positions.size(); i++) {
+        orderer.seedMoveOrderer(positions[i], false);
+        for(Move& move : moveLists[i]) {
+            CentipawnScore exchange = HeuristicMoveOrderer::staticExchangeEvaluation(positions[i], move);
+            losing += exchange < 0;
+            different += exchange != orderer.getStaticExchangeEvaluation(move);
+        }
+    }
+    out << " ◌ " << losing << " of " << moves << " moves lose material, ";
+    out << (different == 0 ? "the same either way." : std::to_string(different) + " DIFFERENT!") << std::endl;
+
+    volatile long sink = 0;
+    report(out, "static exchanges (from scratch)", 500, moves, [&positions, &moveLists, &sink]() {
+        long total = 0;
+        for(size_t i = 0; i < positions.size(); i++) {
+            for(Move& move : moveLists[i]) {
+                total += HeuristicMoveOrderer::staticExchangeEvaluation(positions[i], move);
+            }
+        }
+        sink = sink + total;
+    });
+    report(out, "static exchanges (attackers shared per square)", 500, moves, [&positions, &moveLists, &orderer, &sink]() {
+        long total = 0;
+        for(size_t i = 0; i < positions.size(); i++) {
+            orderer.seedMoveOrderer(positions[i], false);
+            for(Move& move : moveLists[i]) {
+                total += orderer.getStaticExchangeEvaluation(move);
+            }
+        }
+        sink = sink + total;
+    });
+}
@@ -0,0 +1,47 @@
+#ifndef _MICROBENCH_H
+#define _MICROBENCH_H
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "board.h"
+
+/**
+ * Small timing loops over the hot parts of the engine (making moves, evaluating, and so on),
+ * so a change to one of them can be measured on its own rather than through a whole search.
+ * These run from the shell with `microbench [name]`.
+ */
+class Microbenchmark {
+public:
+    /**
+     * Runs the benchmark with the given name, or all of them for "all".
+     * Returns false if there is no such benchmark.
+     */
+    static bool run(const std::string& name, std::ostream& out);
+    static std::vector<std::string> getNames();
+private:
+    struct Benchmark {
+        std::string name;
+        std::function<void(std::ostream&)> run;
+    };
+    static const std::vector<Benchmark>& getBenchmarks();
+    /**
+     * A handful of varied positions (opening, middlegame, endgame, lots of tactics) to run things on.
+     */
+    static std::vector<Board> getPositions();
+    /**
+     * Times `iterations` calls of body (which should do `operationsPerCall` of the thing being measured),
+     * and prints how many million operations per second that is.
+     */
+    static void report(std::ostream& out, const std::string& label, long iterations, long operationsPerCall, const std::function<void()>& body);
+
+    static void makeMoves(std::ostream& out);
+    static void evaluate(std::ostream& out);
+    static void sliders(std::ostream& out);
+    static void repetitions(std::ostream& out);
+    static void checks(std::ostream& out);
+    static void exchanges(std::ostream& out);
+};
+
+#endif
@@ -1,45 +1,9 @@
 #include "move.h"
 #include "board.h"
 
-Move::Move() : from{Square::a1}, to{Square::a1}, moveType{Normal}, promotionType{Piece::Knight} {}
-
-Move::Move(Square from, Square to, Move::MoveType moveType, Piece promoType) : from{from}, to{to}, moveType{moveType}, promotionType{promoType} { }
-
-bool Move::operator==(const Move& other) const {
-    return from == other.from && to == other.to && moveType == other.moveType && promotionType == other.promotionType;
-}
-
-bool Move::operator!=(const Move& other) const {
-    return !(*this == other);
-}
-
-Square Move::getFrom() const {
-    return from;
-}
-
 Square Move::getEnpassantSquareCaptured(Color turn) const {
-    assert(moveType == Enpassant);
-    return getSquareFromIndex(to - 8 + (turn << 4));
-}
-
-bool Move::isMoveNone() const {
-    return from == Square::a1 && to == Square::a1 && moveType == Normal && promotionType == Piece::Knight;
-}
-
-bool Move::isMovePromotion() const {
-    return getMoveType() == Promotion;
-}
-
-Square Move::getTo() const {
-    return to;
-}
-
-Move::MoveType Move::getMoveType() const {
-    return moveType;
-}
-
-Piece Move::getPromoType() const {
-    return promotionType;
+    assert(getMoveType() == Enpassant);
+    return getSquareFromIndex(getTo() - 8 + (turn << 4));
 }
 
 void Move::print(std::ostream& out) const {
@@ -76,3 +40,20 @@ std::string Move::toString() const {
     return fr;
 }
 
+std::string Move::toUciString() const {
+    if(isMoveNone()) {
+        return "0000";
+    }
+    std::string output = Board::squareToString(getFrom());
+    if(getMoveType() == Castle) {
+        //we store castling as the king moving onto its own rook, UCI wants the square the king lands on
+        output += getTo() > getFrom() ? 'g' : 'c';
+        output += Board::squareToString(getTo())[1];
+    } else {
+        output += Board::squareToString(getTo());
+    }
+    if(isMovePromotion()) {
+        output += "nbrq"[getPromoType() - Knight];
+    }
+    return output;
+}
@@ -5,7 +5,11 @@
 #include "constants.h"
 
 /**
- * More or less a POD class to store moves
+ * More or less a POD class to store moves.
+ * A move is packed into 16 bits (low to high): 6 bits from square, 6 bits to square, 2 bits move type
+ * and 2 bits promotion piece (Knight through Queen). This keeps move lists, killers, counter moves
+ * and the undo stack small, and makes comparing moves a single integer comparison.
+ * The empty move is all zeros (a1a1, which is never a real move).
  */ 
 class Move {
 public:
@@ -20,37 +24,72 @@ public:
      * Creates an empty move.
      * NOTE: moves are immutable, so doing this cannot be changed
      */
-    Move();
-    Move(const Move& other) = default;
-    Move(Square from, Square to, MoveType moveType, Piece promotionPiece = Piece::Knight);
-    Move& operator=(const Move& move) = default;
-    bool operator==(const Move& move) const;
-    bool operator!=(const Move& move) const;
+    constexpr Move() : data{0} {}
+    constexpr Move(const Move& other) = default;
+    constexpr Move(Square from, Square to, MoveType moveType, Piece promotionPiece = Piece::Knight)
+        : data{static_cast<uint16_t>(from | (to << 6) | (moveType << 12) | ((promotionPiece - Knight) << 14))} {
+        assert(Knight <= promotionPiece && promotionPiece <= Queen);
+    }
+    /**
+     * For getting a move back from getData.
+     */
+    static constexpr Move fromData(uint16_t data) {
+        Move move;
+        move.data = data;
+        return move;
+    }
+    constexpr Move& operator=(const Move& move) = default;
+    constexpr bool operator==(const Move& move) const {
+        return data == move.data;
+    }
+    constexpr bool operator!=(const Move& move) const {
+        return data != move.data;
+    }
 
-    Square getFrom() const;
-    Square getTo() const;
+    constexpr Square getFrom() const {
+        return static_cast<Square>(data & 0x3F);
+    }
+    constexpr Square getTo() const {
+        return static_cast<Square>((data >> 6) & 0x3F);
+    }
     Square getEnpassantSquareCaptured(Color turn) const;
-    MoveType getMoveType() const;
-    Piece getPromoType() const;
-    bool isMoveNone() const;
-    bool isMovePromotion() const;
+    constexpr MoveType getMoveType() const {
+        return static_cast<MoveType>((data >> 12) & 0x3);
+    }
+    constexpr Piece getPromoType() const {
+        return static_cast<Piece>((data >> 14) + Knight);
+    }
+    constexpr bool isMoveNone() const {
+        return data == 0;
+    }
+    constexpr bool isMovePromotion() const {
+        return getMoveType() == Promotion;
+    }
+    /**
+     * The packed 16 bits of the move.
+     */
+    constexpr uint16_t getData() const {
+        return data;
+    }
 
     void print(std::ostream& out) const;
     std::string toString() const;
+    /**
+     * The move in UCI's long algebraic notation, e.g. e1g1 for castling or e7e8q for promotion.
+     */
+    std::string toUciString() const;
 private:
-    Square from;
-    Square to;
-    MoveType moveType;
-    Piece promotionType;
+    uint16_t data;
 };
+static_assert(sizeof(Move) == 2, "moves should be packed into 16 bits");
 
 /**
- * For use with unordered_map, just hash based on the from and to squares
+ * For use with unordered_map, the packed move is already a perfect hash
  */
 namespace std {
     template <> struct hash<Move> {
         std::size_t operator()(const Move& move) const {
-            return move.getFrom() | (move.getTo() << 6);
+            return move.getData();
         }
     };
 }
@@ -0,0 +1,104 @@
+#ifndef _MOVE_LIST_H
+#define _MOVE_LIST_H
+#include <array>
+#include <cassert>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "constants.h"
+#include "move.h"
+
+/**
+ * A fixed capacity list of moves, with a score slot alongside every move for move ordering.
+ * Move generation happens at every node of the search, so this lives on the stack (or inside
+ * a move orderer that's reused) instead of on the heap, meaning generating moves never allocates.
+ * Only the parts of std::vector's interface we actually use are here.
+ */
+class MoveList {
+public:
+    MoveList() = default;
+
+    template <class... Args> void emplace_back(Args&&... args) {
+        assert(length < MaxNumMoves);
+        new (data() + length) Move{std::forward<Args>(args)...};
+        scores[length] = 0;
+        length++;
+    }
+    void push_back(const Move& move) {
+        emplace_back(move);
+    }
+    void clear() {
+        length = 0;
+    }
+    int size() const {
+        return length;
+    }
+    bool empty() const {
+        return length == 0;
+    }
+
+    Move& operator[](int index) {
+        assert(0 <= index && index < length);
+        return data()[index];
+    }
+    const Move& operator[](int index) const {
+        assert(0 <= index && index < length);
+        return data()[index];
+    }
+    Move& front() {
+        return (*this)[0];
+    }
+    Move& back() {
+        return (*this)[length - 1];
+    }
+    /**
+     * Removes the move at the given index, keeping the rest in order.
+     */
+    void erase(int index) {
+        assert(0 <= index && index < length);
+        for(int i = index; i < length - 1; i++) {
+            data()[i] = data()[i + 1];
+            scores[i] = scores[i + 1];
+        }
+        length--;
+    }
+
+    void swap(int first, int second) {
+        assert(0 <= first && first < length && 0 <= second && second < length);
+        std::swap(data()[first], data()[second]);
+        std::swap(scores[first], scores[second]);
+    }
+
+    int& getScore(int index) {
+        assert(0 <= index && index < length);
+        return scores[index];
+    }
+
+    Move* begin() {
+        return data();
+    }
+    Move* end() {
+        return data() + length;
+    }
+    const Move* begin() const {
+        return data();
+    }
+    const Move* end() const {
+        return data() + length;
+    }
+private:
+    static_assert(std::is_trivially_copyable<Move>::value && std::is_trivially_destructible<Move>::value, "moves are stored as raw bytes");
+    //raw storage rather than an array of moves, so making a list doesn't construct MaxNumMoves empty moves first
+    alignas(Move) unsigned char storage[MaxNumMoves * sizeof(Move)];
+    std::array<int, MaxNumMoves> scores;
+    int length = 0;
+
+    Move* data() {
+        return reinterpret_cast<Move*>(storage);
+    }
+    const Move* data() const {
+        return reinterpret_cast<const Move*>(storage);
+    }
+};
+
+#endif
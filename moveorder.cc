@@ -9,44 +9,75 @@ static constexpr std::array<CentipawnScore, NumPieces> seeScores = {100, 400, 40
  *  MVV-LVA values for each piece
  */
 static constexpr std::array<HeuristicScore, NumPieces> mvvLvaScores = {0, 3000, 3500, 5000, 10000, 11000};
-static CentipawnScore currentSEEMargin = 0;
+/**
+ * Noisy moves that lose SEE get their SEE value added to this as their score, so they sort below everything else
+ * and the value can be read back out.
+ */
+static constexpr HeuristicScore BadNoisyScore = -161660; //haha funny meme number
+/**
+ * Any score below this belongs to a bad noisy move. What sets those apart is their SEE value, which is kept for the search,
+ * not for ordering, so they all rank the same.
+ */
+static constexpr HeuristicScore BadNoisyCeiling = BadNoisyScore / 2;
 
 /**
+ * The tables in MoveHistory, in more detail:
+ *
  * Killer moves are refutations that produced beta cutoffs at the same depth in adjacent nodes.
  * These are heuristically good to check, because odds are, a move that refutes moves in sibling positions
  * will also refute moves in our position.
  * Ordered by depth. 
- */
-static std::array<Move, MaxDepth> killerHistoryOne;
-static std::array<Move, MaxDepth> killerHistoryTwo;
-/**
- * Indexed by [pieceColor][piece][toSquare].
- * Counter moves are refutations to moving a certain piece to a certain square,
+ *
+ * Counter moves, indexed by [pieceColor][piece][toSquare], are refutations to moving a certain piece to a certain square,
  * since usually something that refutes a move like that will repeatedly refute it.
- */
-static TripleArray<Move, NumColors, NumPieces, NumSquares> counterMoves;
-/**
- * Indexed by [pieceColor][piece][toSquare]. 
- * A butterfly history of how good moving a piece to a square is as a move in past evaluations,
- * since this is a heuristically good past indicator of how good a move is to be.
- */
-static TripleArray<HeuristicScore, NumColors, NumPieces, NumSquares> quietHistory;
-
-/**
- * Indexed by [aggressor][toSquare][victim].
+ *
+ * Quiet history, indexed by [pieceColor][piece][toSquare], is a butterfly history of how good moving a piece to a square
+ * is as a move in past evaluations, since this is a heuristically good past indicator of how good a move is to be.
+ *
+ * Capture history, indexed by [aggressor][toSquare][victim], is
  * Most Valuable Victim-Least Valuable Aggressor (MVV-LVA) combined with a history-style heuristic.
  * (This is not a butterfly heuristic like last above, but rather a heuristic based on which piece on which square is captured by which piece)
  * The history heuristic is as described above, we combine this with MVV-LVA,
  * which is a heuristic that says capturing things worth a lot with pieces not worth a lot is a good idea.
  */
-static TripleArray<HeuristicScore, NumPieces, NumSquares, NumPieces> captureHistory;
+MoveHistory::MoveHistory() {
+    clear();
+}
+
+void MoveHistory::clear() {
+    killerHistoryOne.fill(Move{});
+    killerHistoryTwo.fill(Move{});
+    for(int i = 0; i < NumColors; ++i) {
+        for(int j = 0; j < NumPieces; ++j) {
+            for(int k = 0; k < NumSquares; ++k) {
+                counterMoves[i][j][k] = Move{};
+                quietHistory[i][j][k] = 0;
+            }
+        }
+    }
+    for(int i = 0; i < NumPieces; ++i) {
+        for(int j = 0; j < NumSquares; ++j) {
+            for(int k = 0; k < NumPieces; ++k) {
+                captureHistory[i][j][k] = 0;
+            }
+        }
+    }
+}
 
-static bool hasBeenInit = false;
+Move MoveHistory::getKillerOne(int ply) const {
+    return killerHistoryOne[ply];
+}
 
-MoveOrderer::MoveOrderer() {
-    moveList.reserve(MaxNumMoves);
+Move MoveHistory::getKillerTwo(int ply) const {
+    return killerHistoryTwo[ply];
 }
 
+Move MoveHistory::getCounterMove(const Board& board) const {
+    return counterMoves[flipColor(board.getTurn())][board.getLastMovedPiece()][board.getLastPlayedMove().getTo()];
+}
+
+MoveOrderer::MoveOrderer() {}
+
 RandomMoveOrderer::RandomMoveOrderer() : MoveOrderer{} {
     std::random_device rand;
     rng = std::mt19937{rand()};
@@ -71,153 +102,116 @@ Move RandomMoveOrderer::pickNextMove(bool noisyOnly) {
     int random = randomDistribution(rng);
     
     Move move = moveList[random];
-    moveList.erase(moveList.begin() + random);
+    moveList.erase(random);
     size--;
     return move;
 }
 
-HeuristicMoveOrderer::HeuristicMoveOrderer() : MoveOrderer{}, currentMoveScores{} {
-    init();
+HeuristicMoveOrderer::HeuristicMoveOrderer(std::shared_ptr<MoveHistory> history) : MoveOrderer{}, history{history} {}
+
+CentipawnScore HeuristicMoveOrderer::staticExchangeEvaluation(Board& board, const Move& move) {
+    if(move.getMoveType() == Move::Castle) {
+        return 0;
+    }
+    //the move itself can uncover attackers (and en passant takes a pawn off a different square), which the swap list picks up
+    return staticExchangeEvaluation(board, move, board.getAllSquareAttackers(board.sides[White] | board.sides[Black], move.getTo()));
 }
 
-void HeuristicMoveOrderer::init() {
-    if(hasBeenInit) {
-        return;
+CentipawnScore HeuristicMoveOrderer::getStaticExchangeEvaluation(const Move& move) {
+    assert(board != nullptr);
+    if(move == exchangeMove) {
+        return exchangeValue;
     }
-    killerHistoryOne.fill(Move{});
-    killerHistoryTwo.fill(Move{});
-    for(int i = 0; i < NumColors; ++i) {
-        for(int j = 0; j < NumPieces; ++j) {
-            for(int k = 0; k < NumSquares; ++k) {
-                counterMoves[i][j][k] = Move{};
-                quietHistory[i][j][k] = 0;
-            }
-        }
+    if(move.getMoveType() == Move::Castle) {
+        return 0;
     }
-    for(int i = 0; i < NumPieces; ++i) {
-        for(int j = 0; j < NumSquares; ++j) {
-            for(int k = 0; k < NumPieces; ++k) {
-                captureHistory[i][j][k] = 0;
-            }
-        }
+    Square to = move.getTo();
+    if(!Board::testBit(attackedSquares, to)) {
+        squareAttackers[to] = board->getAllSquareAttackers(board->sides[White] | board->sides[Black], to);
+        attackedSquares |= 1ull << to;
     }
-    hasBeenInit = true;
+    return staticExchangeEvaluation(*board, move, squareAttackers[to]);
 }
 
-bool HeuristicMoveOrderer::staticExchangeEvaluation(Board& board, const Move& move, CentipawnScore margin) {
-    if(move.getMoveType() == Move::Castle) {
-        return true;
-    }
-    //Iteratively go through the pieces that can attack the square in question (taking into account piece values) and 
-    //determine who wins.
-    CentipawnScore sideBalance = 0;
+CentipawnScore HeuristicMoveOrderer::staticExchangeEvaluation(Board& board, const Move& move, Bitboard attackers) {
+    assert(move.getMoveType() != Move::Castle);
+    //Play out the captures on the square, each side always taking with its least valuable piece,
+    //keeping track of what the side that just captured would be up if the exchange stopped there.
+    std::array<CentipawnScore, NumSquares / 2 + 1> gains;
+    Square to = move.getTo();
 
     //After doing the capture, the next victim is the piece we captured with unless we promote and 
-    //that piece changes (done in the below if statement)
+    //that piece changes
     Piece victim = getPieceType(board.getPieceAt(move.getFrom()));
-
-    if(move.getMoveType() != Move::Enpassant) {
+    //The occupied bitboard given that the first move happened.
+    Bitboard occupiedBoard = ((board.sides[White] | board.sides[Black]) ^ (1ull << move.getFrom())) | (1ull << to);
+    if(move.getMoveType() == Move::Enpassant) {
+        gains[0] = seeScores[Pawn];
+        occupiedBoard ^= 1ull << move.getEnpassantSquareCaptured(board.turn);
+    } else {
         //how valuable is the thing we are capturing
-        if(board.getPieceAt(move.getTo()) != Empty) {
-            sideBalance = seeScores[getPieceType(board.getPieceAt(move.getTo()))];
-        } else {
-            sideBalance = 0;
-        }
+        gains[0] = board.getPieceAt(to) != Empty ? seeScores[getPieceType(board.getPieceAt(to))] : 0;
         if(move.getMoveType() == Move::Promotion) {
             victim = move.getPromoType();
             //add the value of promoting our thing to SEE
-            sideBalance += seeScores[move.getPromoType()];
-            sideBalance -= seeScores[Pawn];
+            gains[0] += seeScores[move.getPromoType()] - seeScores[Pawn];
         }
-    } else { //enpassant
-        sideBalance = seeScores[Pawn];
-    }
-
-    sideBalance -= margin; //how far do we have to win SEE for it to be worth it
-    
-    //If we get a free piece (i.e. no further captures) happen and we still lose,
-    //the exchange must just be worse for us
-    if(sideBalance < 0) {
-        return false;
-    }
-    sideBalance += seeScores[victim];
-    //Even if they get the full piece for free with no further recaptures from us
-    //and we still win, we must just win the exchange
-    if(sideBalance >= 0) {
-        return true;
-    }
-
-    //Now that the trivial cases are out of the way, let's roll up our sleeves
-    //and count everything.
-
-    //The occupied bitboard given that the first move happened.
-    Bitboard occupiedBoard = ((board.sides[White] | board.sides[Black]) ^ (1ull << move.getFrom())) | (1ull << move.getTo());
-    if(move.getMoveType() == Move::Enpassant) {
-        occupiedBoard ^= (1ull << board.enpassantSquare);
     }
 
     Bitboard bishops = board.pieces[Bishop] | board.pieces[Queen];
     Bitboard rooks = board.pieces[Rook] | board.pieces[Queen];
-
-    Bitboard allSquareAttackers = (Board::PrecomputedBinary::getBinary().getPawnAttacksFromSquare(move.getTo(), White) & board.sides[Black] & board.pieces[Pawn])
-                                | (Board::PrecomputedBinary::getBinary().getPawnAttacksFromSquare(move.getTo(), Black) & board.sides[White] & board.pieces[Pawn])
-                                | (Board::PrecomputedBinary::getBinary().getKnightAttacksFromSquare(move.getTo()) & board.pieces[Knight])
-                                | (Board::PrecomputedBinary::getBinary().getBishopAttacksFromSquare(move.getTo(), occupiedBoard) & bishops)
-                                | (Board::PrecomputedBinary::getBinary().getRookAttacksFromSquare(move.getTo(), occupiedBoard) & rooks)
-                                | (Board::PrecomputedBinary::getBinary().getKingAttacksFromSquare(move.getTo()) & board.pieces[King]);
+    //the piece that moved may have been in the way of a slider behind it (en passant can open up either)
+    bool enpassant = move.getMoveType() == Move::Enpassant;
+    bool straight = Board::getRankIndexOfSquare(move.getFrom()) == Board::getRankIndexOfSquare(to) || Board::getFileIndexOfSquare(move.getFrom()) == Board::getFileIndexOfSquare(to);
+    bool linedUp = Board::PrecomputedBinary::getBinary().getLineMask(move.getFrom(), to) != 0;
+    if(enpassant || (linedUp && !straight)) {
+        attackers |= Board::PrecomputedBinary::getBinary().getBishopAttacksFromSquare(to, occupiedBoard) & bishops;
+    }
+    if(enpassant || (linedUp && straight)) {
+        attackers |= Board::PrecomputedBinary::getBinary().getRookAttacksFromSquare(to, occupiedBoard) & rooks;
+    }
     //so the original piece doesn't attack twice
-    allSquareAttackers &= occupiedBoard;
+    attackers &= occupiedBoard;
 
     Color turn = flipColor(board.turn);
-
-    for(Bitboard attackers = allSquareAttackers & board.sides[turn]; attackers != 0;) {
+    int captures = 0;
+    for(Bitboard ours = attackers & board.sides[turn]; ours != 0; ours = attackers & board.sides[turn]) {
         //find the next piece we can attack with with least value
-        if((attackers & board.pieces[Pawn]) != 0) {
-            victim = Pawn;
-        } else if((attackers & board.pieces[Knight]) != 0) {
-            victim = Knight;
-        } else if((attackers & board.pieces[Bishop]) != 0) {
-            victim = Bishop;
-        } else if((attackers & board.pieces[Rook]) != 0) {
-            victim = Rook;
-        } else if((attackers & board.pieces[Queen]) != 0) {
-            victim = Queen;
-        } else {
-            victim = King;
+        Piece attacker = Pawn;
+        while((ours & board.pieces[attacker]) == 0) {
+            attacker = static_cast<Piece>(attacker + 1);
+        }
+        //a king can't take on a square the other side still attacks
+        if(attacker == King && (attackers & board.sides[flipColor(turn)]) != 0) {
+            break;
         }
+        captures++;
+        gains[captures] = seeScores[victim] - gains[captures - 1];
+        victim = attacker;
+
         //remove this attacker from its current square
-        occupiedBoard ^= (1ull << Board::getLsb(attackers & board.pieces[victim]));
+        occupiedBoard ^= (1ull << Board::getLsb(ours & board.pieces[attacker]));
         //If we attacked diagonally, we could open up a diagonal
-        if(victim == Pawn || victim == Bishop || victim == Queen) {
-            allSquareAttackers |= (Board::PrecomputedBinary::getBinary().getBishopAttacksFromSquare(move.getTo(), occupiedBoard) & bishops);
+        if(attacker == Pawn || attacker == Bishop || attacker == Queen) {
+            attackers |= (Board::PrecomputedBinary::getBinary().getBishopAttacksFromSquare(to, occupiedBoard) & bishops);
         }
         //if we attacked on a straight, we could open up a rank/file
-        if(victim == Rook || victim == Queen) {
-            allSquareAttackers |= (Board::PrecomputedBinary::getBinary().getRookAttacksFromSquare(move.getTo(), occupiedBoard) & rooks);
+        if(attacker == Rook || attacker == Queen) {
+            attackers |= (Board::PrecomputedBinary::getBinary().getRookAttacksFromSquare(to, occupiedBoard) & rooks);
         }
         //Don't add attacks we already figured out
-        allSquareAttackers &= occupiedBoard;
-
-        //flip the turn, for which their balance is the inverse of ours (since they are doing the same exchange but sides reverse)
+        attackers &= occupiedBoard;
         turn = flipColor(turn);
-        //and then add the next victim score
-        sideBalance = -sideBalance - 1 - seeScores[victim];
-
-        //if we just are winning even after losing the piece we capture with
-        //for nothing, we win the exchange, unless we captured with our king and the opponent still has attackers
-        if(sideBalance >= 0) {
-            if(victim == King && (allSquareAttackers & board.sides[turn]) != 0) {
-                //change who wins as we break out of the loop
-                turn = flipColor(turn);
-            }
-            break;
-        }
     }
-    //we win if we were not the side who ran out of valid pieces first
-    return turn != board.turn;
+    //now go back up the list: every side can choose not to recapture if that would leave it worse off
+    while(captures > 0) {
+        gains[captures - 1] = -std::max(-gains[captures - 1], gains[captures]);
+        captures--;
+    }
+    return gains[0];
 }
 
-HeuristicScore HeuristicMoveOrderer::getNewHistoryValue(HeuristicScore oldValue, int depth, bool positiveBonus) {
+HeuristicScore MoveHistory::getNewHistoryValue(HeuristicScore oldValue, int depth, bool positiveBonus) {
     //Citation: the following formula is one commonly used in the chess engine world,
     //notably by Stockfish, Ethereal, and Weiss
     HeuristicScore bonus = depth > 12 ? 32 : 16 * depth * depth + 128 * std::max(depth - 1, 0);
@@ -227,7 +221,7 @@ HeuristicScore HeuristicMoveOrderer::getNewHistoryValue(HeuristicScore oldValue,
     return oldValue + signedBonus - (oldValue * bonus / 16000);
 }
 
-void HeuristicMoveOrderer::updateQuietHeuristics(const Board& board, std::vector<Move>& moveList, int depth) {
+void MoveHistory::updateQuietHeuristics(const Board& board, MoveList& moveList, int depth) {
     //update killers & counter move
 
     //The move that caused a beta cut is the final one on the list given to us
@@ -257,7 +251,7 @@ void HeuristicMoveOrderer::updateQuietHeuristics(const Board& board, std::vector
     }
 }
 
-void HeuristicMoveOrderer::updateNoisyHeuristics(const Board& board, std::vector<Move>& moveList, Move& best, int depth) {
+void MoveHistory::updateNoisyHeuristics(const Board& board, MoveList& moveList, Move& best, int depth) {
     for(Move& move : moveList) {
         Piece capturedPiece;
         if(move.getMoveType() == Move::Normal) {
@@ -270,37 +264,32 @@ void HeuristicMoveOrderer::updateNoisyHeuristics(const Board& board, std::vector
     }
 }
 
-Move HeuristicMoveOrderer::popBestMove(int beginRange, int endRange) {
-    Move best = moveList.front();
-    int bestIndex = 0;
-
+void HeuristicMoveOrderer::selectBestMove(int beginRange, int endRange) {
+    int bestIndex = beginRange;
     for(int i = beginRange + 1; i < endRange; i++) {
-        if(currentMoveScores[moveList[i]] > currentMoveScores[best]) {
-            best = moveList[i];
+        if(std::max(moveList.getScore(i), BadNoisyCeiling) > std::max(moveList.getScore(bestIndex), BadNoisyCeiling)) {
             bestIndex = i;
         }
     }
-    moveList.erase(moveList.begin() + bestIndex);
-    return best;
+    moveList.swap(bestIndex, endRange - 1);
 }
 
-Move HeuristicMoveOrderer::popFirstMove() {
-    Move move = moveList.front();
-    moveList.erase(moveList.begin());
-    return move;
-}
-
-void HeuristicMoveOrderer::setSeeMarginInOrdering(CentipawnScore seeMargin) {
-    currentSEEMargin = seeMargin;
+void HeuristicMoveOrderer::setSeeMarginInOrdering(CentipawnScore margin) {
+    seeMargin = margin;
 }
 
 void HeuristicMoveOrderer::seedMoveOrderer(Board& board, bool tacticalSearch) {
     this->board = &board;
     moveList.clear();
-    moveList.reserve(MaxNumMoves);
     noisySize = 0;
     quietSize = 0;
-    currentStage = GenerateNoisy;
+    quietBegin = 0;
+    checksSize = 0;
+    checksBegin = 0;
+    currentStage = HashMove;
+    hashMove = Move{};
+    attackedSquares = 0;
+    exchangeMove = Move{};
     this->tacticalSearch = tacticalSearch;
     if(tacticalSearch) {
         //Don't play refutation moves here, they're tactical enough such that we
@@ -310,15 +299,15 @@ void HeuristicMoveOrderer::seedMoveOrderer(Board& board, bool tacticalSearch) {
         counter = Move{};
     } else {
         //Generate refutation moves
-        killerOne = killerHistoryOne[board.getTotalPlies()];
-        killerTwo = killerHistoryTwo[board.getTotalPlies()];
+        killerOne = history->getKillerOne(board.getTotalPlies());
+        killerTwo = history->getKillerTwo(board.getTotalPlies());
         if(board.getTotalPlies() > 0 && !board.getLastPlayedMove().isMoveNone()) {
-            counter = counterMoves[flipColor(board.getTurn())][board.getLastMovedPiece()][board.getLastPlayedMove().getTo()];
+            counter = history->getCounterMove(board);
         } else {
             counter = Move{};
         }
     }
-    currentSEEMargin = 0;
+    seeMargin = 0;
 }
 
 Move HeuristicMoveOrderer::pickNextMove(bool noisyOnly) {
@@ -328,14 +317,21 @@ Move HeuristicMoveOrderer::pickNextMove(bool noisyOnly) {
         noisyOnly = tacticalSearch;
     }
     switch(currentStage) {
+        case HashMove:
+            //Step 0. If a previous search told us what the best move here was, it's very likely to still be best.
+            currentStage = GenerateNoisy;
+            if(!hashMove.isMoveNone() && (!noisyOnly || board->isMoveTactical(hashMove)) && board->isMovePseudoLegal(hashMove)) {
+                return hashMove;
+            }
+            [[fallthrough]];
         case GenerateNoisy:
             //Step 1. generate noisy moves and then order them.
             //This is always done regardless if we are doing a tactical search or not.
             noisySize = board->generateAllNoisyMoves(moveList);
     
             //set MVV-LVA and history for each noisy move
-            for(Move& move : moveList) {
-                currentMoveScores[move] = getNoisyHeuristic(*board, move);
+            for(int i = 0; i < noisySize; ++i) {
+                moveList.getScore(i) = history->getNoisyHeuristic(*board, moveList[i]);
             }
             [[fallthrough]];
         //if there's a good noisy move available, play it first
@@ -343,22 +339,30 @@ Move HeuristicMoveOrderer::pickNextMove(bool noisyOnly) {
             //set stage if we fell through
             currentStage = GoodNoisy;
             while(noisySize != 0) {
-                Move bestMove = popBestMove(0, noisySize);
-                noisySize--;
-
-                if(currentMoveScores[bestMove] < 0) {
+                selectBestMove(0, noisySize);
+                if(moveList.getScore(noisySize - 1) < 0) {
                     //we have ran out of moves that pass SEE, so we are out of good noisy moves
+                    //(the rest stay in the list, to be looked at as bad noisy moves)
                     break;
                 }
+                noisySize--;
+                Move bestMove = moveList[noisySize];
+
+                //we already tried this one
+                if(bestMove == hashMove) {
+                    continue;
+                }
 
                 //if the move doesn't pass SEE, it's a bad capture we should probably not consider
-                if(!staticExchangeEvaluation(*board, bestMove, currentSEEMargin)) {
-                    currentMoveScores[bestMove] = -161660; //haha funny meme number
-                    moveList.emplace_back(bestMove); //place it back at the back of the noisy list to be considered later
-                    noisySize++;
+                CentipawnScore exchange = getStaticExchangeEvaluation(bestMove);
+                if(exchange < seeMargin) {
+                    moveList.getScore(noisySize) = BadNoisyScore + exchange;
+                    noisySize++; //put it back with the noisy moves to be considered later
                     continue;
                 }
-                //Ok, our move passed SEE, so let's try it.
+                //Ok, our move passed SEE, so let's try it (and keep the result, the search wants it too).
+                exchangeMove = bestMove;
+                exchangeValue = exchange;
 
                 //If we hit a refutation move, then get rid of that refutation
                 //move from future consideration since we are about to pick it.
@@ -379,7 +383,10 @@ Move HeuristicMoveOrderer::pickNextMove(bool noisyOnly) {
             //If we successfully play it, our next move should be the next killer move
             //so set the stage we should be at to do so if we end up returning.
             currentStage = KillerTwo;
-            if(!noisyOnly && board->isMovePseudoLegal(killerOne)) {
+            if(noisyOnly) {
+                //not given back, so a quiet check can't be mistaken for it later
+                killerOne = Move{};
+            } else if(killerOne != hashMove && board->isMovePseudoLegal(killerOne)) {
                 return killerOne;
             }
             [[fallthrough]];
@@ -389,25 +396,29 @@ Move HeuristicMoveOrderer::pickNextMove(bool noisyOnly) {
             //so set the stage we should be at to do so if we end up returning.
             currentStage = Counter;
                 
-            if(!noisyOnly && board->isMovePseudoLegal(killerTwo)) {
+            if(noisyOnly) {
+                killerTwo = Move{};
+            } else if(killerTwo != hashMove && board->isMovePseudoLegal(killerTwo)) {
                 return killerTwo;
             }
             [[fallthrough]];
         case Counter:
             //Set the stage we should be at if we end up returning
             currentStage = GenerateQuiet;
-            if(!noisyOnly && counter != killerOne && counter != killerTwo && board->isMovePseudoLegal(counter)) {
+            if(noisyOnly) {
+                counter = Move{};
+            } else if(counter != killerOne && counter != killerTwo && counter != hashMove && board->isMovePseudoLegal(counter)) {
                 return counter;
             }
             [[fallthrough]];
         //Step 4:     
         case GenerateQuiet:
+            quietBegin = moveList.size();
             if(!noisyOnly) {
                 quietSize = board->generateAllQuietMoves(moveList);
                 //set histories
-                for(int i = noisySize; i < noisySize + quietSize; ++i) {
-                    Move& move = moveList[i];
-                    currentMoveScores[move] = getQuietHeuristic(*board, move);
+                for(int i = quietBegin; i < quietBegin + quietSize; ++i) {
+                    moveList.getScore(i) = history->getQuietHeuristic(*board, moveList[i]);
                 }
             }
             [[fallthrough]];    
@@ -416,25 +427,68 @@ Move HeuristicMoveOrderer::pickNextMove(bool noisyOnly) {
             currentStage = Quiet;    
             if(!noisyOnly) {
                 while(quietSize != 0) {
-                    Move bestMove = popBestMove(noisySize, noisySize + quietSize);
+                    selectBestMove(quietBegin, quietBegin + quietSize);
                     quietSize--;
+                    Move bestMove = moveList[quietBegin + quietSize];
 
-                    if(bestMove == killerOne || bestMove == killerTwo || bestMove == counter) {
+                    if(bestMove == killerOne || bestMove == killerTwo || bestMove == counter || bestMove == hashMove) {
                         continue;
                     }
                     return bestMove;
                 }
             }
             [[fallthrough]];
-        //Step 5. bad noisy. These correspond to captures/noisy moves that are usually obviously ridiculous
+        //Step 5. If we were told to stop looking at quiets before we got through them, still look at the ones that give check.
+        //Those are generated by themselves rather than picked out of the quiets that are left.
+        case QuietChecks:
+            if(noisyOnly && !tacticalSearch) {
+                if(currentStage != QuietChecks) {
+                    checksBegin = moveList.size();
+                    checksSize = board->generateQuietChecks(moveList);
+                    for(int i = checksBegin; i < checksBegin + checksSize; ++i) {
+                        moveList.getScore(i) = history->getQuietHeuristic(*board, moveList[i]);
+                    }
+                }
+                currentStage = QuietChecks;
+                while(checksSize != 0) {
+                    selectBestMove(checksBegin, checksBegin + checksSize);
+                    checksSize--;
+                    Move bestMove = moveList[checksBegin + checksSize];
+                    if(bestMove == killerOne || bestMove == killerTwo || bestMove == counter || bestMove == hashMove) {
+                        continue;
+                    }
+                    //the quiets we gave back before being told to stop sit just before the checks
+                    Move* givenBack = moveList.begin() + quietBegin + quietSize;
+                    if(std::find(givenBack, moveList.begin() + checksBegin, bestMove) != moveList.begin() + checksBegin) {
+                        continue;
+                    }
+                    return bestMove;
+                }
+            }
+            [[fallthrough]];
+        //Step 6. bad noisy. These correspond to captures/noisy moves that are usually obviously ridiculous
         //and should be skipped if we are in a tactical search that only cares about immediately 
         //pressing moves.
         case BadNoisy:
             currentStage = BadNoisy;
             if(!tacticalSearch) {
-                while(moveList.size() != 0) {
-                    Move move = popFirstMove();
-                    if(move == killerOne || move == killerTwo || move == counter) {
+                //whatever is left over: the noisy moves first, then any quiets we didn't get to (unless we're done with quiets)
+                while(noisySize != 0 || (!noisyOnly && quietSize != 0)) {
+                    Move move;
+                    if(noisySize != 0) {
+                        selectBestMove(0, noisySize);
+                        noisySize--;
+                        move = moveList[noisySize];
+                        //everything left here already went through SEE while we were looking for good moves
+                        assert(moveList.getScore(noisySize) < 0);
+                        exchangeMove = move;
+                        exchangeValue = moveList.getScore(noisySize) - BadNoisyScore;
+                    } else {
+                        selectBestMove(quietBegin, quietBegin + quietSize);
+                        quietSize--;
+                        move = moveList[quietBegin + quietSize];
+                    }
+                    if(move == killerOne || move == killerTwo || move == counter || move == hashMove) {
                         continue;
                     }
                     return move;
@@ -455,7 +509,7 @@ std::unique_ptr<MoveOrderer> HeuristicMoveOrderer::clone() const {
     return std::make_unique<HeuristicMoveOrderer>(*this);
 }
 
-HeuristicScore HeuristicMoveOrderer::getNoisyHeuristic(const Board& board, const Move& move) {
+HeuristicScore MoveHistory::getNoisyHeuristic(const Board& board, const Move& move) const {
     Piece capturedPiece;
     if(move.getMoveType() == Move::Normal) {
         capturedPiece = getPieceType(board.getPieceAt(move.getTo()));
@@ -472,10 +526,14 @@ HeuristicScore HeuristicMoveOrderer::getNoisyHeuristic(const Board& board, const
     return historyValue + mvvLvaValue + NormalizationConstant;
 }
 
-HeuristicScore HeuristicMoveOrderer::getQuietHeuristic(const Board& board, const Move& move) {
+HeuristicScore MoveHistory::getQuietHeuristic(const Board& board, const Move& move) const {
     return quietHistory[board.getTurn()][getPieceType(board.getPieceAt(move.getFrom()))][move.getTo()];
 }
 
+void HeuristicMoveOrderer::setHashMove(const Move& move) {
+    hashMove = move;
+}
+
 bool HeuristicMoveOrderer::isAtQuiets() {
     return currentStage >= Quiet;
 }
\ No newline at end of file
@@ -4,7 +4,6 @@
 #include "board.h"
 #include "move.h"
 #include "evaluator.h"
-#include <unordered_map>
 #include <random>
 #include <memory>
 
@@ -26,7 +25,7 @@ public:
 protected:
     Board* board = nullptr;
     bool tacticalSearch = false;
-    std::vector<Move> moveList;
+    MoveList moveList;
     int size = 0;
 };
 
@@ -46,56 +45,119 @@ private:
     std::mt19937 rng;
 };
 
+/**
+ * The tables of past search results that the heuristic move orderer uses to guess which moves are good.
+ * These are learned as the search goes, so every search thread needs its own (see moveorder.cc for what each one is).
+ */
+class MoveHistory {
+public:
+    MoveHistory();
+    void clear();
+
+    void updateQuietHeuristics(const Board& board, MoveList& moveList, int depth);
+    void updateNoisyHeuristics(const Board& board, MoveList& moveList, Move& best, int depth);
+    HeuristicScore getNoisyHeuristic(const Board& board, const Move& move) const;
+    HeuristicScore getQuietHeuristic(const Board& board, const Move& move) const;
+    Move getKillerOne(int ply) const;
+    Move getKillerTwo(int ply) const;
+    Move getCounterMove(const Board& board) const;
+private:
+    static HeuristicScore getNewHistoryValue(HeuristicScore oldValue, int depth, bool positiveBonus);
+
+    std::array<Move, MaxDepth> killerHistoryOne;
+    std::array<Move, MaxDepth> killerHistoryTwo;
+    TripleArray<Move, NumColors, NumPieces, NumSquares> counterMoves;
+    TripleArray<HeuristicScore, NumColors, NumPieces, NumSquares> quietHistory;
+    TripleArray<HeuristicScore, NumPieces, NumSquares, NumPieces> captureHistory;
+
+    //This normalizes the scores to be centered approximately around 0
+    static const HeuristicScore NormalizationConstant = 66666;
+};
+
 /**
  * The main move orderer that does non trivial useful things. 
  */
 class HeuristicMoveOrderer : public MoveOrderer {
 public:    
-    HeuristicMoveOrderer();
+    /**
+     * Orderers made from the same history (or cloned from each other) share it.
+     */
+    HeuristicMoveOrderer(std::shared_ptr<MoveHistory> history = std::make_shared<MoveHistory>());
     HeuristicMoveOrderer(const HeuristicMoveOrderer& other) = default;
     /**
      * Static exchange evaluation looks at the possible trades on a square
-     * and determines if one side can clearly materially win it without having to actually
+     * and determines how much one side materially wins or loses by without having to actually
      * calculate further. For instance, if a pawn takes a queen, then that side will always win the trade
      * because they can choose to stop and just be up a queen for a pawn. 
-     * Returns whether the side that plays the move wins the trade or not.
+     * Returns what the side that plays the move comes out ahead by (negative if it loses material).
+     */
+    static CentipawnScore staticExchangeEvaluation(Board& board, const Move& move);
+    /**
+     * The same for a move in the position we were seeded with. The pieces attacking each square are only looked up once
+     * per position, and a move that has been through SEE for ordering isn't evaluated again.
      */
-    static bool staticExchangeEvaluation(Board& board, const Move& move, CentipawnScore margin);
-    static void setSeeMarginInOrdering(CentipawnScore margin);
+    CentipawnScore getStaticExchangeEvaluation(const Move& move);
+    /**
+     * How far a noisy move has to win SEE by to be ordered as a good one. Must be called after seeding.
+     */
+    void setSeeMarginInOrdering(CentipawnScore margin);
 
-    static void init();
-    static void updateQuietHeuristics(const Board& board, std::vector<Move>& moveList, int depth);
-    static void updateNoisyHeuristics(const Board& board, std::vector<Move>& moveList, Move& best, int depth);
     void seedMoveOrderer(Board& board, bool tacticalSearch) final override;
+    /**
+     * Once asked for noisy moves only (outside of a tactical search), the quiets we haven't given back yet are dropped,
+     * except for the ones that give check, which are generated by themselves.
+     */
     Move pickNextMove(bool noisyOnly) final override;
     std::unique_ptr<MoveOrderer> clone() const override;
 
-    static HeuristicScore getNoisyHeuristic(const Board& board, const Move& move);
-    static HeuristicScore getQuietHeuristic(const Board& board, const Move& move);
     bool isAtQuiets();
+    /**
+     * The best move found for this position by a previous search (from the transposition table).
+     * It gets tried before anything else. Must be called after seeding.
+     */
+    void setHashMove(const Move& move);
 private:
-    std::unordered_map<Move, HeuristicScore> currentMoveScores;
     enum Stage {
-        GenerateNoisy = 0, GoodNoisy, KillerOne, KillerTwo, Counter, GenerateQuiet, Quiet, BadNoisy
+        HashMove = 0, GenerateNoisy, GoodNoisy, KillerOne, KillerTwo, Counter, GenerateQuiet, Quiet, QuietChecks, BadNoisy
     };
-    Stage currentStage;
+    Stage currentStage = HashMove;
 
-    Move popBestMove(int beginRange, int endRange);
-    Move popFirstMove();
-    static HeuristicScore getNewHistoryValue(HeuristicScore oldValue, int depth, bool positiveBonus);
+    /**
+     * Swaps the highest scoring move in [beginRange, endRange) of the move list to position endRange - 1,
+     * so that picking it is just shrinking the range by one.
+     */
+    void selectBestMove(int beginRange, int endRange);
+    /**
+     * The swap list itself: attackers are all the pieces attacking the move's target square once it has been played.
+     */
+    static CentipawnScore staticExchangeEvaluation(Board& board, const Move& move, Bitboard attackers);
+
+    std::shared_ptr<MoveHistory> history;
+    CentipawnScore seeMargin = 0;
+
+    //The move list holds the noisy moves followed by the quiet ones (starting at quietBegin),
+    //then the quiet checks (starting at checksBegin) if we were asked for noisy moves only after all.
+    //The first noisySize, quietSize and checksSize moves of each are the ones we haven't given back yet.
+    int noisySize = 0;
+    int quietSize = 0;
+    int quietBegin = 0;
+    int checksSize = 0;
+    int checksBegin = 0;
 
-    int noisySize;
-    int quietSize;
+    //The attackers of each square in attackedSquares (looked up when SEE first needs them), and the SEE value of
+    //the move we last gave back, if we worked it out. Bad noisy moves keep theirs in their score slots.
+    Bitboard attackedSquares = 0;
+    std::array<Bitboard, NumSquares> squareAttackers;
+    Move exchangeMove;
+    CentipawnScore exchangeValue = 0;
 
     /*
      * The following are moves that are (heuristically) good to check first if the situation arises,
      * as they are likely to produce an alpha beta prune (see explanation in .cc file)
      */
+    Move hashMove;
     Move killerOne;
     Move killerTwo;
     Move counter;
-
-    //This normalizes the scores to be centered approximately around 0
-    static const HeuristicScore NormalizationConstant = 66666;
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include "nnue.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <immintrin.h>
+
+/**
+ * The kernels, one set per instruction set. The vector ones are compiled for their target with function attributes
+ * rather than compiler flags, so the same binary still runs (on the scalar ones) on CPUs without them.
+ */
+namespace {
+    void addScalar(int16_t* values, const int16_t* weights) {
+        for(int i = 0; i < Network::HiddenSize; i++) {
+            values[i] += weights[i];
+        }
+    }
+    void subtractScalar(int16_t* values, const int16_t* weights) {
+        for(int i = 0; i < Network::HiddenSize; i++) {
+            values[i] -= weights[i];
+        }
+    }
+    int32_t clippedDotScalar(const int16_t* values, const int16_t* weights) {
+        int32_t sum = 0;
+        for(int i = 0; i < Network::HiddenSize; i++) {
+            sum += std::clamp<int32_t>(values[i], 0, Network::QuantizationA) * weights[i];
+        }
+        return sum;
+    }
+
+    __attribute__((target("sse4.1"))) void addSse(int16_t* values, const int16_t* weights) {
+        for(int i = 0; i < Network::HiddenSize; i += 8) {
+            __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(values + i));
+            __m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(weights + i));
+            _mm_store_si128(reinterpret_cast<__m128i*>(values + i), _mm_add_epi16(v, w));
+        }
+    }
+    __attribute__((target("sse4.1"))) void subtractSse(int16_t* values, const int16_t* weights) {
+        for(int i = 0; i < Network::HiddenSize; i += 8) {
+            __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(values + i));
+            __m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(weights + i));
+            _mm_store_si128(reinterpret_cast<__m128i*>(values + i), _mm_sub_epi16(v, w));
+        }
+    }
+    __attribute__((target("sse4.1"))) int32_t clippedDotSse(const int16_t* values, const int16_t* weights) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i max = _mm_set1_epi16(Network::QuantizationA);
+        __m128i sum = _mm_setzero_si128();
+        for(int i = 0; i < Network::HiddenSize; i += 8) {
+            __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(values + i));
+            __m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(weights + i));
+            v = _mm_min_epi16(_mm_max_epi16(v, zero), max);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(v, w));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(sum);
+    }
+
+    __attribute__((target("avx2"))) void addAvx2(int16_t* values, const int16_t* weights) {
+        for(int i = 0; i < Network::HiddenSize; i += 16) {
+            __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(values + i));
+            __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + i));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(values + i), _mm256_add_epi16(v, w));
+        }
+    }
+    __attribute__((target("avx2"))) void subtractAvx2(int16_t* values, const int16_t* weights) {
+        for(int i = 0; i < Network::HiddenSize; i += 16) {
+            __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(values + i));
+            __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + i));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(values + i), _mm256_sub_epi16(v, w));
+        }
+    }
+    __attribute__((target("avx2"))) int32_t clippedDotAvx2(const int16_t* values, const int16_t* weights) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i max = _mm256_set1_epi16(Network::QuantizationA);
+        __m256i sum = _mm256_setzero_si256();
+        for(int i = 0; i < Network::HiddenSize; i += 16) {
+            __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(values + i));
+            __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + i));
+            v = _mm256_min_epi16(_mm256_max_epi16(v, zero), max);
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(v, w));
+        }
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(half);
+    }
+}
+
+Network::Network() {
+    if(__builtin_cpu_supports("avx2")) {
+        kernels = {"avx2", addAvx2, subtractAvx2, clippedDotAvx2};
+    } else if(__builtin_cpu_supports("sse4.1")) {
+        kernels = {"sse4.1", addSse, subtractSse, clippedDotSse};
+    } else {
+        kernels = {"scalar", addScalar, subtractScalar, clippedDotScalar};
+    }
+}
+
+bool Network::load(const std::string& path) {
+    std::ifstream file{path, std::ios::binary};
+    if(!file) {
+        return false;
+    }
+    char magic[4];
+    uint32_t header[3];
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if(!file || std::memcmp(magic, "HMNN", 4) != 0 || header[0] != 1 || header[1] != HiddenSize || header[2] != NumKingBuckets) {
+        return false;
+    }
+    std::unique_ptr<Weights> newWeights = std::make_unique<Weights>();
+    file.read(reinterpret_cast<char*>(newWeights->featureWeights.data()), sizeof(newWeights->featureWeights));
+    file.read(reinterpret_cast<char*>(newWeights->featureBiases.data()), sizeof(newWeights->featureBiases));
+    file.read(reinterpret_cast<char*>(newWeights->outputWeights.data()), sizeof(newWeights->outputWeights));
+    file.read(reinterpret_cast<char*>(&newWeights->outputBias), sizeof(newWeights->outputBias));
+    //the file has to be exactly the right length
+    if(!file || file.peek() != std::ifstream::traits_type::eof()) {
+        return false;
+    }
+    weights = std::move(newWeights);
+    generation++;
+    return true;
+}
+
+bool Network::isLoaded() const {
+    return weights != nullptr;
+}
+
+int Network::getGeneration() const {
+    return generation;
+}
+
+std::string Network::getKernelName() const {
+    return kernels.name;
+}
+
+int Network::getFeatureIndex(Color perspective, Square king, ColorPiece piece, Square square) {
+    //look at the board from our side
+    int relativeKing = perspective == White ? king : king ^ 56;
+    int relativeSquare = perspective == White ? square : square ^ 56;
+    //and mirror it so our king is on the a-d files
+    if(relativeKing % NumFiles >= NumFiles / 2) {
+        relativeKing ^= 7;
+        relativeSquare ^= 7;
+    }
+    int kingBucket = (relativeKing / NumFiles) * (NumFiles / 2) + relativeKing % NumFiles;
+    int pieceIndex = (getColorOfPiece(piece) == perspective ? 0 : NumPieces) + getPieceType(piece);
+    return (kingBucket * 2 * NumPieces + pieceIndex) * NumSquares + relativeSquare;
+}
+
+void Network::addFeature(int16_t* values, int feature) const {
+    kernels.add(values, weights->featureWeights[feature].data());
+}
+
+void Network::removeFeature(int16_t* values, int feature) const {
+    kernels.subtract(values, weights->featureWeights[feature].data());
+}
+
+void Network::resetToBias(int16_t* values) const {
+    std::copy(weights->featureBiases.begin(), weights->featureBiases.end(), values);
+}
+
+CentipawnScore Network::evaluate(const Accumulator& accumulator, Color us) const {
+    int64_t output = kernels.clippedDot(accumulator.values[us].data(), weights->outputWeights.data())
+                   + kernels.clippedDot(accumulator.values[flipColor(us)].data(), weights->outputWeights.data() + HiddenSize)
+                   + weights->outputBias;
+    return output * Scale / (QuantizationA * QuantizationB);
+}
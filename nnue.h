@@ -0,0 +1,101 @@
+#ifndef _NNUE_H
+#define _NNUE_H
+
+#include <array>
+#include <memory>
+#include <string>
+#include "constants.h"
+
+/**
+ * An efficiently updatable neural network (NNUE) for evaluation.
+ *
+ * The network is a single hidden layer, evaluated from both sides' points of view:
+ *  - The input features are HalfKA: every (our king square, piece, square) triple, where the king square
+ *    is mirrored onto the a-d files (so 32 king buckets), and the pieces are "ours" or "theirs".
+ *  - The first layer turns the active features of each side into HiddenSize int16 values, the accumulator.
+ *    Moving a piece only turns a couple of features on or off, so the board keeps the accumulator up to date
+ *    with a few vector adds per move instead of recomputing it (only a king move needs a refresh, and only for its side).
+ *  - The output is a clipped ReLU of both accumulators (side to move first) dotted with the output weights.
+ *
+ * The network file is little-endian: the magic "HMNN", then the version, hidden size and number of king buckets
+ * as uint32s, then the int16 feature weights [NumFeatures][HiddenSize], int16 feature biases [HiddenSize],
+ * int16 output weights [2 * HiddenSize] and an int32 output bias.
+ * Weights are quantized: the first layer by QuantizationA, the output layer by QuantizationB.
+ */
+class Network {
+public:
+    static const int HiddenSize = 256;
+    static const int NumKingBuckets = 32;
+    static const int NumFeatures = NumKingBuckets * 2 * NumPieces * NumSquares;
+    static constexpr int QuantizationA = 255;
+    static constexpr int QuantizationB = 64;
+    //network outputs are in units of roughly 1/Scale of a win probability, this gets them back to centipawns
+    static const int Scale = 400;
+
+    struct alignas(32) Accumulator {
+        std::array<std::array<int16_t, HiddenSize>, NumColors> values;
+        //whether each side's values are up to date, and the king square they were computed for
+        std::array<bool, NumColors> upToDate{};
+        std::array<Square, NumColors> kings{};
+        //which network they were computed by, since loading another one makes them all stale
+        int generation = 0;
+    };
+
+    /**
+     * Your friendly neighbourhood singleton of network weights, shared by every board and thread.
+     */
+    static Network& getNetwork() {
+        static Network instance;
+        return instance;
+    }
+    Network(const Network& other) = delete;
+    void operator=(const Network& other) = delete;
+
+    /**
+     * Loads a network file, returning whether it worked (if it didn't, the previous network is kept).
+     * Not safe to call while anything is searching.
+     */
+    bool load(const std::string& path);
+    bool isLoaded() const;
+    int getGeneration() const;
+    /**
+     * Which vector instructions the kernels ended up using: "avx2", "sse4.1" or "scalar".
+     */
+    std::string getKernelName() const;
+
+    static int getFeatureIndex(Color perspective, Square king, ColorPiece piece, Square square);
+    /**
+     * Turns a feature on or off in one side's accumulator.
+     */
+    void addFeature(int16_t* values, int feature) const;
+    void removeFeature(int16_t* values, int feature) const;
+    void resetToBias(int16_t* values) const;
+    /**
+     * The evaluation in centipawns from the point of view of `us`.
+     */
+    CentipawnScore evaluate(const Accumulator& accumulator, Color us) const;
+private:
+    Network();
+
+    struct Weights {
+        alignas(32) std::array<std::array<int16_t, HiddenSize>, NumFeatures> featureWeights;
+        alignas(32) std::array<int16_t, HiddenSize> featureBiases;
+        alignas(32) std::array<int16_t, 2 * HiddenSize> outputWeights;
+        int32_t outputBias;
+    };
+    std::unique_ptr<Weights> weights;
+    int generation = 0;
+
+    /**
+     * The vector kernels, picked once at startup from what the CPU supports.
+     */
+    struct Kernels {
+        std::string name;
+        void (*add)(int16_t* values, const int16_t* weights);
+        void (*subtract)(int16_t* values, const int16_t* weights);
+        int32_t (*clippedDot)(const int16_t* values, const int16_t* weights);
+    };
+    Kernels kernels;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "perft.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+uint64_t Perft::Result::getNodesPerSecond() const {
+    return nodes * 1000 / std::max(1l, milliseconds);
+}
+
+Perft::Perft(int threadCount, int hashSizeMegabytes) : threadCount{std::max(1, threadCount)} {
+    if(hashSizeMegabytes > 0) {
+        //round down to a power of two number of entries so indexing is just a mask
+        uint64_t numEntries = 1;
+        while(numEntries * 2 * sizeof(Entry) <= (uint64_t)hashSizeMegabytes << 20) {
+            numEntries *= 2;
+        }
+        table = std::unique_ptr<Entry[]>(new Entry[numEntries]);
+        tableMask = numEntries - 1;
+        for(uint64_t i = 0; i <= tableMask; i++) {
+            table[i].keyXorData.store(0, std::memory_order_relaxed);
+            table[i].data.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+Perft::Result Perft::run(const Board& board, int depth) {
+    Result result;
+    auto start = std::chrono::steady_clock::now();
+
+    Board rootBoard = board.clonePosition();
+    MoveList rootMoves;
+    rootBoard.generateAllLegalMoves(rootMoves);
+    if(depth == 0) {
+        result.nodes = 1;
+    } else {
+        for(Move& move : rootMoves) {
+            result.divide.emplace_back(move, 0);
+        }
+        //each thread grabs the next root move nobody has taken yet, until there are none left
+        std::atomic<int> nextRootMove{0};
+        auto work = [this, &board, &result, &nextRootMove, depth]() {
+            Board threadBoard = board.clonePosition();
+            Board::UndoData undo;
+            for(int i = nextRootMove++; i < (int)result.divide.size(); i = nextRootMove++) {
+                threadBoard.applyMoveWithUndo(result.divide[i].first, undo);
+                result.divide[i].second = (depth == 1) ? 1 : perft(threadBoard, depth - 1);
+                threadBoard.revertMove(undo);
+            }
+        };
+        std::vector<std::thread> helpers;
+        for(int i = 1; i < std::min(threadCount, (int)result.divide.size()); i++) {
+            helpers.emplace_back(work);
+        }
+        work();
+        for(std::thread& helper : helpers) {
+            helper.join();
+        }
+        for(auto const& x : result.divide) {
+            result.nodes += x.second;
+        }
+        std::sort(result.divide.begin(), result.divide.end(), [](const std::pair<Move, uint64_t>& a, const std::pair<Move, uint64_t>& b) {
+            return a.first.toString() < b.first.toString();
+        });
+    }
+
+    result.milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+uint64_t Perft::perft(Board& board, int depth) {
+    MoveList moveList;
+    board.generateAllLegalMoves(moveList);
+    //bulk counting: the moves themselves are the leaves, no need to make them
+    if(depth == 1) {
+        return moveList.size();
+    }
+
+    uint64_t key = getKey(board, depth);
+    uint64_t nodes = 0;
+    if(probe(key, nodes)) {
+        return nodes;
+    }
+
+    Board::UndoData undo;
+    for(Move& move : moveList) {
+        board.applyMoveWithUndo(move, undo);
+        nodes += perft(board, depth - 1);
+        board.revertMove(undo);
+    }
+    store(key, nodes);
+    return nodes;
+}
+
+uint64_t Perft::getKey(const Board& board, int depth) {
+    //an arbitrary odd constant (from splitmix64) to spread the bits out
+    return board.getBoardHash() ^ ((uint64_t)depth * 0x94D049BB133111EBull);
+}
+
+bool Perft::probe(uint64_t key, uint64_t& nodes) const {
+    if(table == nullptr) {
+        return false;
+    }
+    Entry& entry = table[key & tableMask];
+    uint64_t data = entry.data.load(std::memory_order_relaxed);
+    //an empty entry has no data, and a torn write from another thread won't match the key
+    if(data == 0 || (entry.keyXorData.load(std::memory_order_relaxed) ^ data) != key) {
+        return false;
+    }
+    nodes = data;
+    return true;
+}
+
+void Perft::store(uint64_t key, uint64_t nodes) {
+    if(table == nullptr) {
+        return;
+    }
+    Entry& entry = table[key & tableMask];
+    entry.keyXorData.store(key ^ nodes, std::memory_order_relaxed);
+    entry.data.store(nodes, std::memory_order_relaxed);
+}
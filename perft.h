@@ -0,0 +1,66 @@
+#ifndef _PERFT_H
+#define _PERFT_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "board.h"
+#include "move.h"
+
+/**
+ * Runs PERFormance Tree tests, which count every legal move sequence of a given length from a position.
+ * The counts are well known for lots of positions, so this is our move generation correctness test,
+ * and how fast it goes is a good benchmark of move generation.
+ *
+ * Three things make it fast enough for deep tests:
+ *  - The root moves are split between threads, each working on its own copy of the position (without its history).
+ *  - At depth 1 we just count the legal moves (bulk counting) rather than making each one.
+ *  - Subtree counts are remembered in a hash table keyed by the position, since many positions are
+ *    reached by several move orders. This is optional, a size of 0 turns it off.
+ */
+class Perft {
+public:
+    /**
+     * What a perft test found: the total, how long it took, and the divide (the count below each root move).
+     */
+    struct Result {
+        uint64_t nodes = 0;
+        long milliseconds = 0;
+        std::vector<std::pair<Move, uint64_t>> divide;
+
+        uint64_t getNodesPerSecond() const;
+    };
+    static const int DefaultHashSizeMegabytes = 64;
+
+    Perft(int threadCount = 1, int hashSizeMegabytes = DefaultHashSizeMegabytes);
+    Perft(const Perft& other) = delete;
+    Perft& operator=(const Perft& other) = delete;
+
+    /**
+     * Runs a test to the given depth. The board is left as it was.
+     */
+    Result run(const Board& board, int depth);
+private:
+    uint64_t perft(Board& board, int depth);
+
+    /**
+     * The perft hash table only ever stores exact counts, so there is no bound or move to remember.
+     * Like the transposition table, the key is stored XORed with the data, so threads can share it without locks.
+     */
+    struct Entry {
+        std::atomic<uint64_t> keyXorData;
+        std::atomic<uint64_t> data;
+    };
+    /**
+     * The Zobrist hash, with the depth folded in since the same position has a different count at each depth.
+     */
+    static uint64_t getKey(const Board& board, int depth);
+    bool probe(uint64_t key, uint64_t& nodes) const;
+    void store(uint64_t key, uint64_t nodes);
+
+    int threadCount;
+    std::unique_ptr<Entry[]> table;
+    uint64_t tableMask = 0;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#include "searchstatistics.h"
+#include <algorithm>
+
+void SearchStatistics::Counters::addTo(Counts& total) const {
+    for(int i = 0; i < NumCounters; i++) {
+        total[i] += counts[i].load(std::memory_order_relaxed);
+    }
+}
+
+void SearchStatistics::Counters::clear() {
+    for(std::atomic<long>& count : counts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+void SearchStatistics::clear() {
+    iterations.clear();
+    recorded.fill(0);
+    search = Iteration{};
+    searchNumber++;
+}
+
+void SearchStatistics::recordIteration(int depth, long milliseconds, const Counts& cumulative) {
+    Iteration iteration{depth, milliseconds, cumulative};
+    for(int i = 0; i < NumCounters; i++) {
+        iteration.counts[i] -= recorded[i];
+    }
+    //the time is the iteration's own too
+    for(const Iteration& previous : iterations) {
+        iteration.milliseconds -= previous.milliseconds;
+    }
+    recorded = cumulative;
+    iterations.push_back(iteration);
+}
+
+void SearchStatistics::recordSearch(long milliseconds, const Counts& cumulative) {
+    search.depth = iterations.empty() ? 0 : iterations.back().depth;
+    search.milliseconds = milliseconds;
+    search.counts = cumulative;
+}
+
+void SearchStatistics::writeJsonLines(std::ostream& out) const {
+    for(const Iteration& iteration : iterations) {
+        writeJsonObject(out, "depth", iteration, searchNumber);
+    }
+    writeJsonObject(out, "search", search, searchNumber);
+    out.flush();
+}
+
+void SearchStatistics::writeJsonObject(std::ostream& out, const char* type, const Iteration& iteration, long searchNumber) {
+    const Counts& counts = iteration.counts;
+    auto rate = [](long part, long whole) {
+        return whole == 0 ? 0.0 : (double)part / whole;
+    };
+    long nodes = counts[Nodes] + counts[QuiescenceNodes];
+    out << "{\"type\":\"" << type << "\",\"search\":" << searchNumber << ",\"depth\":" << iteration.depth
+        << ",\"nodes\":" << nodes << ",\"quiescenceNodes\":" << counts[QuiescenceNodes]
+        << ",\"betaCutoffs\":" << counts[BetaCutoffs] << ",\"firstMoveCutoffRate\":" << rate(counts[FirstMoveCutoffs], counts[BetaCutoffs])
+        << ",\"reducedSearches\":" << counts[ReducedSearches] << ",\"reSearchRate\":" << rate(counts[ReSearches], counts[ReducedSearches])
+        << ",\"razorPrunes\":" << counts[RazorPrunes] << ",\"reverseFutilityPrunes\":" << counts[ReverseFutilityPrunes]
+        << ",\"futilityPrunes\":" << counts[FutilityPrunes] << ",\"lateMovePrunes\":" << counts[LateMovePrunes]
+        << ",\"seePrunes\":" << counts[SeePrunes]
+        << ",\"hashProbes\":" << counts[HashProbes] << ",\"hashHitRate\":" << rate(counts[HashHits], counts[HashProbes])
+        << ",\"hashCutoffs\":" << counts[HashCutoffs]
+        << ",\"milliseconds\":" << iteration.milliseconds << ",\"nps\":" << nodes * 1000 / std::max(1l, iteration.milliseconds)
+        << "}" << std::endl;
+}
@@ -0,0 +1,82 @@
+#ifndef _SEARCH_STATISTICS_H
+#define _SEARCH_STATISTICS_H
+
+#include <array>
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+/**
+ * Counts of what the search got up to (how often each pruning rule fired, how well moves were ordered, and so on),
+ * per iteration of iterative deepening and for the whole search, for tuning the search and catching regressions.
+ *
+ * Counting at every node isn't free, so it is only done in builds with SEARCH_STATISTICS defined (`make STATS=1`).
+ * Otherwise Enabled is false and every count() compiles away to nothing.
+ */
+class SearchStatistics {
+public:
+#ifdef SEARCH_STATISTICS
+    static constexpr bool Enabled = true;
+#else
+    static constexpr bool Enabled = false;
+#endif
+
+    enum Counter {
+        Nodes = 0, QuiescenceNodes,
+        //cutoffs in the main search, and how many of them came from the first move we tried
+        BetaCutoffs, FirstMoveCutoffs,
+        //late move reductions, and how many of them had to be searched again at full depth
+        ReducedSearches, ReSearches,
+        //nodes where each pruning rule kicked in (for futility and late move pruning, that's skipping the rest of the quiets but their checks)
+        RazorPrunes, ReverseFutilityPrunes, FutilityPrunes, LateMovePrunes,
+        //single moves skipped for losing too much material
+        SeePrunes,
+        HashProbes, HashHits, HashCutoffs,
+        NumCounters
+    };
+    typedef std::array<long, NumCounters> Counts;
+
+    /**
+     * One search thread's running counts. Only its own thread writes to them, but the main thread reads them all between iterations.
+     */
+    class Counters {
+    public:
+        void count(Counter counter) {
+            if constexpr(Enabled) {
+                counts[counter].store(counts[counter].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+        }
+        void addTo(Counts& total) const;
+        void clear();
+    private:
+        std::array<std::atomic<long>, NumCounters> counts{};
+    };
+
+    struct Iteration {
+        int depth;
+        long milliseconds;
+        Counts counts;
+    };
+
+    void clear();
+    /**
+     * Called when an iteration finishes, with every thread's counts since the search started
+     * (so an iteration's counts include whatever the helper threads did while the main thread was on it).
+     */
+    void recordIteration(int depth, long milliseconds, const Counts& cumulative);
+    void recordSearch(long milliseconds, const Counts& cumulative);
+    /**
+     * One JSON object per line: one for each iteration, then one for the whole search.
+     */
+    void writeJsonLines(std::ostream& out) const;
+private:
+    std::vector<Iteration> iterations;
+    Counts recorded{};
+    Iteration search{};
+    //how many searches these statistics have been kept for, to tell their lines apart
+    long searchNumber = 0;
+
+    static void writeJsonObject(std::ostream& out, const char* type, const Iteration& iteration, long searchNumber);
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "transposition.h"
+#include <algorithm>
+#include <climits>
+
+TranspositionTable::TranspositionTable(int sizeMegabytes) {
+    resize(sizeMegabytes);
+}
+
+void TranspositionTable::resize(int sizeMegabytes) {
+    assert(sizeMegabytes > 0);
+    //round down to a power of two number of buckets so indexing is just a mask
+    uint64_t numBuckets = 1;
+    while(numBuckets * 2 * sizeof(Bucket) <= (uint64_t)sizeMegabytes << 20) {
+        numBuckets *= 2;
+    }
+    buckets.reset();
+    buckets = std::unique_ptr<Bucket[]>(new Bucket[numBuckets]);
+    bucketMask = numBuckets - 1;
+    this->sizeMegabytes = sizeMegabytes;
+    clear();
+}
+
+void TranspositionTable::clear() {
+    for(uint64_t i = 0; i <= bucketMask; i++) {
+        for(PackedEntry& entry : buckets[i].entries) {
+            entry.keyXorData.store(0, std::memory_order_relaxed);
+            entry.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    age = 0;
+}
+
+void TranspositionTable::newSearch() {
+    age = (age + 1) & AgeMask;
+}
+
+int TranspositionTable::getSizeMegabytes() const {
+    return sizeMegabytes;
+}
+
+uint64_t TranspositionTable::packData(const Move& move, CentipawnScore score, int depth, Bound bound, int age) {
+    uint64_t packedMove = move.getData();
+    assert(SHRT_MIN <= score && score <= SHRT_MAX);
+    uint64_t packedScore = static_cast<uint16_t>(static_cast<int16_t>(score));
+    uint64_t packedDepth = std::max(0, std::min(UCHAR_MAX, depth));
+    return packedMove | (packedScore << 16) | (packedDepth << 32) | ((uint64_t)bound << 40) | ((uint64_t)age << 42);
+}
+
+Move TranspositionTable::unpackMove(uint64_t data) {
+    return Move::fromData(data & 0xFFFF);
+}
+
+CentipawnScore TranspositionTable::unpackScore(uint64_t data) {
+    return static_cast<int16_t>((data >> 16) & 0xFFFF);
+}
+
+int TranspositionTable::unpackDepth(uint64_t data) {
+    return (data >> 32) & 0xFF;
+}
+
+TranspositionTable::Bound TranspositionTable::unpackBound(uint64_t data) {
+    return static_cast<Bound>((data >> 40) & 0x3);
+}
+
+int TranspositionTable::unpackAge(uint64_t data) {
+    return (data >> 42) & AgeMask;
+}
+
+TranspositionTable::Bucket& TranspositionTable::getBucket(uint64_t hash) const {
+    return buckets[hash & bucketMask];
+}
+
+bool TranspositionTable::probe(uint64_t hash, Entry& entry) const {
+    Bucket& bucket = getBucket(hash);
+    for(PackedEntry& packed : bucket.entries) {
+        uint64_t data = packed.data.load(std::memory_order_relaxed);
+        //if another thread was halfway through writing this entry, the key won't match and we treat it as a miss
+        if((packed.keyXorData.load(std::memory_order_relaxed) ^ data) == hash && unpackBound(data) != NoBound) {
+            entry.move = unpackMove(data);
+            entry.score = unpackScore(data);
+            entry.depth = unpackDepth(data);
+            entry.bound = unpackBound(data);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t hash, const Move& move, CentipawnScore score, int depth, Bound bound) {
+    Bucket& bucket = getBucket(hash);
+    PackedEntry* replace = nullptr;
+    int worstValue = INT_MAX;
+    for(PackedEntry& packed : bucket.entries) {
+        uint64_t data = packed.data.load(std::memory_order_relaxed);
+        //always reuse the slot of the same position (or an empty one)
+        if((packed.keyXorData.load(std::memory_order_relaxed) ^ data) == hash || unpackBound(data) == NoBound) {
+            replace = &packed;
+            break;
+        }
+        //otherwise, replace whatever is shallowest, with entries from old searches counting as shallower
+        int value = unpackDepth(data) - 8 * ((age - unpackAge(data)) & AgeMask);
+        if(value < worstValue) {
+            worstValue = value;
+            replace = &packed;
+        }
+    }
+    assert(replace != nullptr);
+
+    uint64_t oldData = replace->data.load(std::memory_order_relaxed);
+    bool samePosition = (replace->keyXorData.load(std::memory_order_relaxed) ^ oldData) == hash && unpackBound(oldData) != NoBound;
+    //don't throw away a deeper result for the same position from this search unless we have an exact score
+    if(samePosition && bound != Exact && unpackAge(oldData) == age && unpackDepth(oldData) > depth + 2) {
+        return;
+    }
+    //a search that didn't find a best move shouldn't erase the one we already knew about
+    Move moveToStore = move;
+    if(samePosition && moveToStore.isMoveNone()) {
+        moveToStore = unpackMove(oldData);
+    }
+    uint64_t data = packData(moveToStore, score, depth, bound, age);
+    replace->keyXorData.store(hash ^ data, std::memory_order_relaxed);
+    replace->data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::getHashfull() const {
+    uint64_t sampleSize = std::min<uint64_t>(1000, bucketMask + 1);
+    int used = 0;
+    for(uint64_t i = 0; i < sampleSize; i++) {
+        for(PackedEntry& packed : buckets[i].entries) {
+            uint64_t data = packed.data.load(std::memory_order_relaxed);
+            if(unpackBound(data) != NoBound && unpackAge(data) == age) {
+                used++;
+            }
+        }
+    }
+    return used * 1000 / (sampleSize * EntriesPerBucket);
+}
@@ -0,0 +1,101 @@
+#ifndef _TRANSPOSITION_H
+#define _TRANSPOSITION_H
+
+#include <atomic>
+#include <memory>
+#include "constants.h"
+#include "move.h"
+
+/**
+ * A fixed size hash table of previously searched positions, keyed by Zobrist hash.
+ * The same position is very often reached through different move orders (a transposition),
+ * so remembering what we found out the last time lets us either skip the search entirely
+ * or at least try the best move from last time first.
+ *
+ * The table is allocated once up front (rounded down to a power of two number of buckets),
+ * so memory use stays flat no matter how long a game goes. Each bucket is exactly one cache line
+ * holding a few entries, so a probe costs at most one cache miss.
+ *
+ * The table is lock-free: every entry stores its key XORed with its data, so a torn write
+ * from another thread just looks like a key mismatch (a miss) rather than corrupted data.
+ */
+class TranspositionTable {
+public:
+    /**
+     * What kind of score an entry holds, relative to the alpha-beta window it was searched with.
+     */
+    enum Bound : uint8_t {
+        NoBound = 0, Upper, Lower, Exact
+    };
+    /**
+     * The unpacked contents of a table entry, as given back by probe.
+     */
+    struct Entry {
+        Move move;
+        CentipawnScore score;
+        int depth;
+        Bound bound;
+    };
+    static const int DefaultSizeMegabytes = 16;
+
+    TranspositionTable(int sizeMegabytes = DefaultSizeMegabytes);
+    TranspositionTable(const TranspositionTable& other) = delete;
+    TranspositionTable& operator=(const TranspositionTable& other) = delete;
+
+    /**
+     * Reallocates the table to the given size (which clears it).
+     */
+    void resize(int sizeMegabytes);
+    void clear();
+    /**
+     * Call once per search, ages out the entries from previous searches so they get replaced first.
+     */
+    void newSearch();
+    /**
+     * Returns whether the position was found, filling in entry if so.
+     */
+    bool probe(uint64_t hash, Entry& entry) const;
+    /**
+     * Scores are stored as given, so the caller is responsible for making mate scores
+     * relative to the position rather than the root.
+     */
+    void store(uint64_t hash, const Move& move, CentipawnScore score, int depth, Bound bound);
+    /**
+     * Approximate fill rate of the table in permille, sampled from the first buckets.
+     */
+    int getHashfull() const;
+    int getSizeMegabytes() const;
+private:
+    /**
+     * Packed layout of the data word (low to high):
+     * 16 bits move, 16 bits score, 8 bits depth, 2 bits bound, 6 bits age.
+     */
+    struct PackedEntry {
+        std::atomic<uint64_t> keyXorData;
+        std::atomic<uint64_t> data;
+    };
+    static const int EntriesPerBucket = 4;
+    struct alignas(64) Bucket {
+        PackedEntry entries[EntriesPerBucket];
+    };
+    static_assert(sizeof(Bucket) == 64, "a bucket should be exactly one cache line");
+
+    static const int AgeBits = 6;
+    static const int AgeMask = (1 << AgeBits) - 1;
+
+    static uint64_t packData(const Move& move, CentipawnScore score, int depth, Bound bound, int age);
+    static Move unpackMove(uint64_t data);
+    static CentipawnScore unpackScore(uint64_t data);
+    static int unpackDepth(uint64_t data);
+    static Bound unpackBound(uint64_t data);
+    static int unpackAge(uint64_t data);
+
+    Bucket& getBucket(uint64_t hash) const;
+
+    std::unique_ptr<Bucket[]> buckets;
+    uint64_t bucketMask = 0;
+    int sizeMegabytes = 0;
+    int age = 0;
+};
+
+#endif
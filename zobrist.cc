@@ -17,16 +17,59 @@ ZobristNums::ZobristNums() {
             }
         }
     }
-    
+    for (uint64_t& num : castleRightsNums) {
+        num = dist(gen);
+    }
+    for (uint64_t& num : enPassantNums) {
+        num = dist(gen);
+    }
+    blackToMoveNum = dist(gen);
+    // no castling rights and no en passant square add nothing, so a hash depends only on what is on the board
+    castleRightsNums[0] = 0;
+    initCuckoo();
 
     // First index is for color of piece
     // Second index is for each type of piece (ordered as in board)
     // second nested array is for each square (0 ... 63)
     // i.e. zorbistNums[0][1][9] is a white knight on a2 
-    // we have leftover sqares in the randomNums array, as pawns are unable to go on the first or final rank.
-    // white to move at index [0][0][0]
-    // castling rights at index [0][0][1-4]
-    // En Passent rights at index [1][0][0-7]
+    // side to move, castling rights and en passant files have their own arrays after that
+}
+
+
+void ZobristNums::initCuckoo() {
+    Board::PrecomputedBinary& binary = Board::PrecomputedBinary::getBinary();
+    binary.init();
+    for (Color color : {White, Black}) {
+        for (Piece piece : {Knight, Bishop, Rook, Queen, King}) {
+            for (int square1 = a1; square1 <= h8; square1++) {
+                Bitboard attacks = 0;
+                switch (piece) {
+                    case Knight: attacks = binary.getKnightAttacksFromSquare(Board::getSquare(square1)); break;
+                    case Bishop: attacks = binary.getBishopAttacksFromSquare(Board::getSquare(square1), 0); break;
+                    case Rook: attacks = binary.getRookAttacksFromSquare(Board::getSquare(square1), 0); break;
+                    case Queen: attacks = binary.getQueenAttacksFromSquare(Board::getSquare(square1), 0); break;
+                    default: attacks = binary.getKingAttacksFromSquare(Board::getSquare(square1)); break;
+                }
+                for (int square2 = square1 + 1; square2 <= h8; square2++) {
+                    if (!Board::testBit(attacks, Board::getSquare(square2))) {
+                        continue;
+                    }
+                    uint64_t key = zobristNums[color][piece][square1] ^ zobristNums[color][piece][square2] ^ blackToMoveNum;
+                    std::pair<Square, Square> move{Board::getSquare(square1), Board::getSquare(square2)};
+                    // put it in its first slot, kicking out whatever was there to that one's other slot, and so on
+                    int slot = getCuckooSlot1(key);
+                    while (true) {
+                        std::swap(cuckooKeys[slot], key);
+                        std::swap(cuckooMoves[slot], move);
+                        if (key == 0) {
+                            break;
+                        }
+                        slot = slot == getCuckooSlot1(key) ? getCuckooSlot2(key) : getCuckooSlot1(key);
+                    }
+                }
+            }
+        }
+    }
 }
 
 
@@ -45,24 +88,57 @@ void ZobristNums::changePiece(uint64_t& hash, Color pieceColor, Piece pieceType,
 
 
 void ZobristNums::flipColor(uint64_t& hash) {
-    hash ^= zn.zobristNums[White][Pawn][a1];
+    hash ^= zn.blackToMoveNum;
+}
+
+
+int ZobristNums::getCastleRightsIndex(Bitboard castlingRooks) {
+    const Bitboard kingside = Board::FileE | Board::FileF | Board::FileG | Board::FileH;
+    return ((castlingRooks & Board::Rank1 & kingside) != 0)
+        | ((castlingRooks & Board::Rank1 & ~kingside) != 0) << 1
+        | ((castlingRooks & Board::Rank8 & kingside) != 0) << 2
+        | ((castlingRooks & Board::Rank8 & ~kingside) != 0) << 3;
 }
 
 
-void ZobristNums::changeCastleRights(uint64_t& hash, Color side, bool isKingside) {
-    if (side == White && isKingside) {
-        hash ^= zn.zobristNums[White][Pawn][b1];
+void ZobristNums::changeCastleRights(uint64_t& hash, Bitboard castlingRooks) {
+    hash ^= zn.castleRightsNums[getCastleRightsIndex(castlingRooks)];
+}
+
+
+void ZobristNums::changeEnPassant(uint64_t& hash, Index file) {
+    hash ^= zn.enPassantNums[file];
+}
+
+
+uint64_t ZobristNums::hashPosition(const Board& board) {
+    uint64_t hash = 0;
+    for (int sq = 0; sq < NumSquares; sq++) {
+        ColorPiece piece = board.squares[sq];
+        if (piece != Empty) {
+            changePiece(hash, getColorOfPiece(piece), getPieceType(piece), Board::getSquare(sq));
+        }
     }
-    if (side == White && !isKingside) {
-        hash ^= zn.zobristNums[White][Pawn][c1];
+    changeCastleRights(hash, board.castlingRooks);
+    if (board.enpassantSquare != None) {
+        changeEnPassant(hash, Board::getFileIndexOfSquare(board.enpassantSquare));
     }
-    if (side != White && isKingside) {
-        hash ^= zn.zobristNums[White][Pawn][d1];
+    if (board.turn == Black) {
+        flipColor(hash);
     }
-    hash ^= zn.zobristNums[White][Pawn][e1];
+    return hash;
 }
 
 
-void ZobristNums::changeEnPassant(uint64_t& hash, Index file) {
-    hash ^= zn.zobristNums[Black][Pawn][a1];
+bool ZobristNums::findCuckooMove(uint64_t keyDifference, Square& square1, Square& square2) {
+    int slot = getCuckooSlot1(keyDifference);
+    if (zn.cuckooKeys[slot] != keyDifference) {
+        slot = getCuckooSlot2(keyDifference);
+        if (zn.cuckooKeys[slot] != keyDifference) {
+            return false;
+        }
+    }
+    square1 = zn.cuckooMoves[slot].first;
+    square2 = zn.cuckooMoves[slot].second;
+    return true;
 }
@@ -9,8 +9,34 @@
 
 class ZobristNums {
     uint64_t zobristNums[NumColors][NumPieces][NumSquares];
+    // one key for each of the 16 combinations of castling rights, so a change is one XOR out and one XOR in
+    uint64_t castleRightsNums[16];
+    uint64_t enPassantNums[NumFiles];
+    uint64_t blackToMoveNum;
+
+    /**
+     * For spotting a move that repeats an earlier position (Board::hasUpcomingRepetition) without generating any moves.
+     * Every move a piece other than a pawn can make on an empty board is keyed by how it changes the hash,
+     * in a cuckoo hash table: each key lives in one of its two slots, so a lookup is just two probes.
+     */
+    static const int CuckooSize = 8192;
+    std::array<uint64_t, CuckooSize> cuckooKeys{};
+    std::array<std::pair<Square, Square>, CuckooSize> cuckooMoves{};
+    static int getCuckooSlot1(uint64_t key) {
+        return key & (CuckooSize - 1);
+    }
+    static int getCuckooSlot2(uint64_t key) {
+        return (key >> 16) & (CuckooSize - 1);
+    }
+    void initCuckoo();
+
     ZobristNums();
 
+    /**
+     * Which of the four castling rights are left, as bits: white kingside, white queenside, black kingside, black queenside.
+     */
+    static int getCastleRightsIndex(Bitboard castlingRooks);
+
 public:
     // singleton pattern (exciting!!), where we enforce only one object created, and destroy copy ctors
     static ZobristNums& getZobrist() {
@@ -23,8 +49,20 @@ public:
     static uint64_t newPosition();
     static void changePiece(uint64_t& hash, Color pieceColor, Piece pieceType, Square pieceLocation);
     static void flipColor(uint64_t& hash);
-    static void changeCastleRights(uint64_t& hash, Color side, bool isKingside);
+    /**
+     * XORs the key of the castling rights left with these castling rooks in or out.
+     */
+    static void changeCastleRights(uint64_t& hash, Bitboard castlingRooks);
     static void changeEnPassant(uint64_t& hash, Index file);
+    /**
+     * The hash worked out from scratch, which the incrementally updated one should always equal.
+     */
+    static uint64_t hashPosition(const Board& board);
+    /**
+     * If moving a piece between two squares (either way, with the turn passing) changes a hash by exactly keyDifference,
+     * gives those squares. Whether the move can actually be played isn't checked.
+     */
+    static bool findCuckooMove(uint64_t keyDifference, Square& square1, Square& square2);
 };
 
 